@@ -0,0 +1,16 @@
+#version 330 core
+
+in vec2 TexCoord0;
+
+out vec3 Color;
+
+// Cleared to zero alpha, so anything left uncovered by the capture is see-through
+uniform sampler2D Texture;
+
+void main() {
+	vec4 texel = texture(Texture, TexCoord0);
+	if (texel.a < 0.5f)
+		discard;
+
+	Color = texel.rgb;
+}
@@ -0,0 +1,20 @@
+#version 330 core
+
+// A corner of the unit quad, from -1 to 1
+layout (location = 0) in vec2 position;
+
+out vec2 TexCoord0;
+
+// Places the captured rectangle in the world (see impostor_placement in main.cpp)
+uniform mat4 M;
+
+#include "view.glsl"
+
+void main() {
+	vec4 hpos = vec4(position, 0.f, 1.f);
+
+	TexCoord0 = position * 0.5f + 0.5f;
+
+	int view = view_index();
+	gl_Position = place_view(VP[view] * M * hpos, view);
+}
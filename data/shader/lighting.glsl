@@ -0,0 +1,59 @@
+// The scene's single light, with its shadow
+// Programs are built with LIGHT_DIRECTION, pointing towards the light (see main.cpp)
+
+// Taps are a square grid, SHADOW_RINGS texels out from the center
+#ifndef SHADOW_RINGS
+#define SHADOW_RINGS 0
+#endif
+
+// Compares against the reference depth in hardware (see hs::sampler::set_compare)
+uniform sampler2DShadow Shadow;
+
+// Shared by every program, written once per frame (see frame_block in main.cpp)
+layout (std140) uniform Frame
+{
+	mat4 ShadowVP;
+	// Depth bias in shadow map units; the light depth range changes every frame
+	float ShadowBias;
+};
+
+vec3 transform(vec3 p, mat4 space)
+{
+	vec4 proj = space * vec4(p, 1.0);
+	return (proj.xyz / proj.w);
+}
+
+// Fraction of the position in shadow
+float shadow(vec3 position)
+{
+	// The light frustum is fitted to the scene, so offsets are in texels
+	vec2 scale = 1.f / vec2(textureSize(Shadow, 0));
+
+	vec3 coord = transform(position, ShadowVP) * 0.5f + 0.5f;
+	float z = coord.z - ShadowBias;
+
+	// Each tap is already a bilinear 2x2 comparison done by the sampler
+	// The ring count is a constant, so the compiler can unroll the grid
+	float lit = 0.f;
+	for (int x = -SHADOW_RINGS; x <= SHADOW_RINGS; ++x)
+	{
+		for (int y = -SHADOW_RINGS; y <= SHADOW_RINGS; ++y)
+		{
+			vec2 offset = vec2(float(x), float(y)) * scale;
+			lit += texture(Shadow, vec3(coord.xy + offset, z));
+		}
+	}
+
+	const float taps = float((2 * SHADOW_RINGS + 1) * (2 * SHADOW_RINGS + 1));
+	return (1.f - lit / taps);
+}
+
+// Diffuse light with a floor, darkened where shadowed
+float light(vec3 position, vec3 normal)
+{
+	// Instance transforms may be scaled (eg, the select mode miniature)
+	float ill = max(dot(normalize(normal), LIGHT_DIRECTION), 0.3f);
+	float sh = max(1.f - (shadow(position) * 0.7f), 0.f) + 0.3f;
+
+	return (sh * ill);
+}
@@ -9,7 +9,8 @@ out vec2 TexCoord0;
 out vec3 Normal0;
 
 uniform mat4 M;
-uniform mat4 VP;
+
+#include "view.glsl"
 
 void main() {
 	vec4 hpos = vec4(position, 1.f);
@@ -18,5 +19,6 @@ void main() {
 	TexCoord0 = texcoord;
 	Normal0   = (M * vec4(normal, 0.f)).xyz;
 
-	gl_Position = VP * M * hpos;
+	int view = view_index();
+	gl_Position = place_view(VP[view] * M * hpos, view);
 }
@@ -4,7 +4,10 @@ layout (location = 0) in vec2 position;
 
 out vec2 TexCoord0;
 
+// Region of the texture to display, as (min, max) texture coordinates
+uniform vec4 Bounds = vec4(0.0, 0.0, 1.0, 1.0);
+
 void main() {
-	TexCoord0 = position * 0.5 + 0.5;
+	TexCoord0 = mix(Bounds.xy, Bounds.zw, position * 0.5 + 0.5);
 	gl_Position = vec4(position, 0.0, 1.0);
 }
@@ -1,11 +1,11 @@
 #version 330 core
 
 layout (location = 0) in vec3 position;
+layout (location = 2) in mat4 M;
 
-uniform mat4 M;
-uniform mat4 VP;
+#include "view.glsl"
 
 void main()
 {
-	gl_Position = VP * M * vec4(position, 1.f);
+	gl_Position = VP[0] * M * vec4(position, 1.f);
 }
@@ -3,11 +3,23 @@
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 
+// Per-instance attributes; M takes locations 2 through 5
+layout (location = 2) in mat4 M;
+#ifdef SELECTION_TINT
+layout (location = 6) in vec3 Tint;
+#endif
+
+// The material color is baked into the shared vertex buffer
+layout (location = 7) in vec3 Color;
+
 out vec3 Position0;
 out vec3 Normal0;
+#ifdef SELECTION_TINT
+out vec3 Tint0;
+#endif
+out vec3 Color0;
 
-uniform mat4 M;
-uniform mat4 VP;
+#include "view.glsl"
 
 void main()
 {
@@ -15,6 +27,11 @@ void main()
 
 	Position0 = (M * hpos).xyz;
 	Normal0   = (M * vec4(normal, 0.f)).xyz;
+#ifdef SELECTION_TINT
+	Tint0     = Tint;
+#endif
+	Color0    = Color;
 
-	gl_Position = VP * M * hpos;
+	int view = view_index();
+	gl_Position = place_view(VP[view] * M * hpos, view);
 }
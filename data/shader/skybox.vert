@@ -4,11 +4,12 @@ layout (location = 0) in vec3 position;
 
 out vec3 TexCoord0;
 
-uniform mat4 VP;
+#include "view.glsl"
 
 void main()
 {
 	TexCoord0 = position;
 
-	gl_Position = VP * vec4(position, 1.0);
+	int view = view_index();
+	gl_Position = place_view(SkyboxVP[view] * vec4(position, 1.0), view);
 }
@@ -0,0 +1,33 @@
+// Shared by every program, written once per view (see view_block in main.cpp)
+layout (std140) uniform View
+{
+	mat4 VP[2];
+	mat4 SkyboxVP[2];
+};
+
+// Programs built with STEREO draw each instance once per eye, left then right
+// Otherwise there is a single view, and nothing is clipped
+int view_index()
+{
+#ifdef STEREO
+	return gl_InstanceID % 2;
+#else
+	return 0;
+#endif
+}
+
+// Squeeze a view into its half of the side-by-side target
+// The other half is clipped away, so the eyes cannot bleed into each other
+vec4 place_view(vec4 clip, int view)
+{
+#ifdef STEREO
+	float side = (view == 0) ? -1.f : 1.f;
+	clip.x = clip.x * 0.5f + side * 0.5f * clip.w;
+
+	gl_ClipDistance[0] = side * clip.x;
+#else
+	gl_ClipDistance[0] = 1.f;
+#endif
+
+	return clip;
+}
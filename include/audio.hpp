@@ -16,6 +16,8 @@
 #include <type_traits>
 #include <vector>
 
+#include <trace.hpp>
+
 class audio {
 public:
 	static const size_t AUDIO_SIZE = 1024;
@@ -105,6 +107,10 @@ public:
 
 	size_t get_frequency() const;
 
+private:
+	// Run by the filler thread; every constructor and move starts it the same way
+	void fill();
+
 private:
 	ALCcontext* m_context;
 	std::vector<std::shared_ptr<source>> m_sources;
@@ -159,6 +165,7 @@ ALenum audio::source::queue_buffer(InsertFn ifn) {
 	static_assert(std::is_same_v<void, std::invoke_result_t<InsertFn, ALuint>>);
 	if (m_buffer_queue.size() == 0) return AL_INVALID_VALUE;
 
+	TRACE_SCOPE("audio::source::queue_buffer");
 	auto buf = m_buffer_queue.front(); m_buffer_queue.pop();
 	ifn(buf);
 
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// The six clip planes of a view, pointing inwards
+struct frustum
+{
+public:
+	// Extract the planes from a view-projection matrix (GL clip space)
+	explicit frustum(const glm::mat4& vp);
+
+public:
+	// xyz is the unit normal, w the distance from the origin
+	std::array<glm::vec4, 6> planes;
+};
+
+// Objects kept and rejected by culling, accumulated over a pass
+struct cull_stats
+{
+public:
+	size_t drawn = 0;
+	size_t culled = 0;
+	// Triangles submitted for the drawn objects, counting every view
+	size_t triangles = 0;
+};
+
+// How large objects appear in a view, used to pick their level of detail
+class projection_scale
+{
+public:
+	// Every object is treated as filling the view, so it is drawn at full detail
+	projection_scale();
+	// A perspective view from eye; pixels is the screen size of one unit at a distance of one
+	// For a GL projection matrix P and a viewport h pixels tall, this is P[1][1] * h / 2
+	projection_scale(const glm::vec3& eye, float pixels);
+
+	// An orthographic view; pixels is the screen size of one unit at any distance
+	static projection_scale orthographic(float pixels);
+
+public:
+	// The diameter, in pixels, of a sphere (xyz the center, w the radius)
+	float size(const glm::vec4& sphere) const;
+
+private:
+	glm::vec3 m_eye;
+	float m_pixels;
+	bool m_perspective;
+};
+
+// Bounding spheres stored as separate component arrays
+// Stored this way so that four spheres can be tested against a plane at once
+class sphere_set
+{
+public:
+	void clear();
+	void push_back(const glm::vec3& center, float radius);
+
+	size_t size() const { return m_count; }
+
+	// Set visible[i] if sphere i touches any of the frustums
+	// An empty list of frustums disables culling
+	void cull(const std::vector<frustum>& any_of, std::vector<unsigned char>& visible) const;
+
+private:
+	// Each array is padded to a multiple of four
+	std::vector<float> m_x;
+	std::vector<float> m_y;
+	std::vector<float> m_z;
+	std::vector<float> m_radius;
+
+	size_t m_count = 0;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+// Hand a value from one writer thread to one reader thread without copying it
+/* The writer fills the back slot while the reader holds the front one, then
+* publishes it as the new front. The reader never waits; it always gets the
+* newest published value. The writer only waits when the reader is still
+* holding the slot it is about to reuse, so it can run at most one value ahead
+*/
+template<class T>
+class double_buffer
+{
+public:
+	double_buffer()
+		: m_front{0}, m_version{0}, m_reading{false}, m_read_slot{0} {}
+
+	double_buffer(const double_buffer&) = delete;
+	double_buffer& operator =(const double_buffer&) = delete;
+
+public:
+	// The slot to fill next; blocks while the reader holds it
+	T& begin_write()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_released.wait(lock, [this] { return !(m_reading && m_read_slot != m_front); });
+
+		return m_slots[1 - m_front];
+	}
+
+	// Make the slot from begin_write the newest value
+	void publish()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_front = 1 - m_front;
+		m_version += 1;
+	}
+
+	// The newest value; it is not changed until release
+	const T& acquire()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_reading = true;
+		m_read_slot = m_front;
+
+		return m_slots[m_read_slot];
+	}
+
+	void release()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_reading = false;
+		}
+
+		m_released.notify_one();
+	}
+
+	// Values published so far
+	size_t version() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_version;
+	}
+
+private:
+	std::array<T, 2> m_slots;
+	size_t m_front;
+	size_t m_version;
+
+	bool m_reading;
+	size_t m_read_slot;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_released;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <heatsink/array_buffer.hpp>
+#include <heatsink/context.hpp>
+#include <heatsink/stream_buffer.hpp>
+#include <heatsink/vertex_array.hpp>
+
+#include <model.hpp>
+
+// A single vertex, index and instance buffer shared by every model
+// Since all meshes use the same vertex arrays, whole passes can be drawn indirectly
+class geometry_arena
+{
+public:
+	// Most views a single draw can cover (see place_view in view.glsl)
+	static constexpr size_t max_views = 2;
+
+	// The part of the arena holding a single mesh
+	struct range
+	{
+	public:
+		GLint base_vertex;
+		GLuint first_index;
+		GLsizei count;
+	};
+
+public:
+	geometry_arena(hs::context& c);
+
+	geometry_arena(const geometry_arena&) = delete;
+	geometry_arena& operator =(const geometry_arena&) = delete;
+
+public:
+	// Append a mesh; it is uploaded with the next flush
+	range allocate(const std::vector<model::vertex>& vertices, const std::vector<GLuint>& indices);
+	// Append more indices into the vertices of an earlier range (eg, a coarser level of detail)
+	range allocate_indices(const range& base, const std::vector<GLuint>& indices);
+
+	// Drop every instance; call at the start of each frame
+	void clear_instances();
+	// Append instances for this frame, and return the index of the first
+	GLuint push_instances(const std::vector<model::instance>& insts);
+
+	// Upload any new meshes, and write this frame's instances to the next region of the stream
+	void flush();
+
+	// The vertex array drawing each instance once per view
+	const hs::vertex_array& get_state(size_t views) const;
+
+	hs::context& get_context() { return m_context; }
+
+	// Frames that had to wait for the GPU before writing instances
+	size_t stalls() const { return m_stalls + m_instances->stalls(); }
+
+private:
+	// Point the instance attributes of every vertex array at the current region
+	void point_instances();
+
+private:
+	std::reference_wrapper<hs::context> m_context;
+
+	// Geometry is kept so the buffers can grow when more models are loaded
+	std::vector<model::vertex> m_vertex_data;
+	std::vector<GLuint> m_index_data;
+	bool m_dirty;
+
+	std::vector<model::instance> m_instance_data;
+
+	hs::array_buffer m_vertices;
+	hs::array_buffer m_indices;
+	// Replaced by a larger stream when a frame outgrows a region
+	std::unique_ptr<hs::stream_buffer> m_instances;
+	size_t m_stalls;
+
+	// Indexed by views - 1; each instance attribute advances once per group of views
+	std::vector<hs::vertex_array> m_states;
+};
@@ -26,7 +26,7 @@ namespace hs
 		array_buffer(context& c, GLenum mode, Container data)
 			: array_buffer(c, mode, std::begin(data), std::end(data)) {}
 
-	private:
+	protected:
 		// Utility for array_buffer::empty
 		// Create a type-annotated array_buffer without specifying valid data
 		template<class T>
@@ -1,17 +1,27 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <deque>
 #include <functional>
-#include <unordered_map>
 #include <type_traits>
+#include <vector>
 
 #include <GL/glew.h>
 #include "bind_state.hpp"
+#include "handle_pool.hpp"
 #include "name_adaptor.hpp"
 #include "name_traits.hpp"
+#include "state_cache.hpp"
 
 namespace hs
 {
 	// An OpenGL surface context; reference counts GL objects created under it
+	/* Names are generated ahead in batches. A name whose last reference is gone
+	* is not deleted at once, but at the first end_frame after the GPU finished
+	* the frame it was released in, so nothing is deleted while still in use.
+	* Anything still waiting when the window closes goes with its GL context
+	*/
 	class context
 	{
 	public:
@@ -37,9 +47,9 @@ namespace hs
 		protected:
 			// Allow for internal creation of arbitrary identifiers
 			identifier(GLuint name)
-				: bind_state<T>(name), m_context{context::empty_context} {}
+				: bind_state<T>(name), m_context{context::empty_context}, m_handle{handle_pool::null_handle} {}
 			identifier(GLuint name, GLenum mode)
-				: bind_state<T>(name, mode), m_context{context::empty_context} {}
+				: bind_state<T>(name, mode), m_context{context::empty_context}, m_handle{handle_pool::null_handle} {}
 
 		public:
 			// Expose the bind methods of bind_state
@@ -63,29 +73,35 @@ namespace hs
 
 		protected:
 			std::reference_wrapper<context> m_context;
+
+		private:
+			friend class context;
+
+			// Null for default identifiers, and after being moved from
+			handle_pool::handle m_handle;
 		};
 
 	public:
 		friend class window;
 
-	private:
-		// Not all GLuint IDs are unique; T may be required to differentiate
-		struct unique_name
-		{
-			bool operator ==(const unique_name& other) const;
+	public:
+		static context empty_context;
 
-			GLenum type;
-			GLuint name;
+		// Every GL type an identifier can be created for; each has its own pool
+		static constexpr std::array<GLenum, 6> types =
+		{
+			GL_BUFFER, GL_FRAMEBUFFER, GL_PROGRAM, GL_SAMPLER, GL_TEXTURE, GL_VERTEX_ARRAY
 		};
 
-		// unordered_map requires a comparison and hash function for custom types
-		struct unique_name_hash
+		// The position of a type in types, or types.size() if it is not there
+		static constexpr size_t type_index(GLenum type)
 		{
-			size_t operator ()(const unique_name& n) const;
-		};
+			for (size_t i = 0; i != types.size(); ++i)
+				if (types[i] == type)
+					return i;
 
-	public:
-		static context empty_context;
+			return types.size();
+		}
 
 	public:
 		context(const context&) = delete;
@@ -94,10 +110,36 @@ namespace hs
 	private:
 		context() = default;
 
+	public:
+		// The binding state is a cache, so it may change through a const context
+		state_cache& get_state() const { return m_state; }
+
+		// The number of GL objects of a type currently alive in this context
+		size_t live_objects(GLenum type) const { return m_pools.at(type_index(type)).live(); }
+		// Names released but not yet deleted, over every type
+		size_t pending_deletions() const;
+
+		// Fence the names released this frame, and delete those of frames the GPU has finished
+		// Call once per frame, after its work is submitted
+		void end_frame();
+
 	private:
+		template<GLenum T>
+		static constexpr size_t pool_index()
+		{
+			constexpr auto i = type_index(T);
+			static_assert(i < types.size(), "context: GL type has no pool");
+
+			return i;
+		}
+
+		// Take a name from the spares, generating another batch if there are none
+		template<GLenum T>
+		GLuint create_name();
+
 		// Called by identifier after construction/allocation of name
 		template<GLenum T>
-		void count_references(const identifier<T>& i);
+		void count_references(identifier<T>& i);
 
 		// Add to the reference count of an identifier
 		template<GLenum T>
@@ -107,7 +149,28 @@ namespace hs
 		void decrement_references(const identifier<T>& i);
 
 	private:
-		std::unordered_map<unique_name, size_t, unique_name_hash> m_references;
+		using name_lists = std::array<std::vector<GLuint>, types.size()>;
+
+		// Names released in a finished frame, deleted once its fence signals
+		struct retired_names
+		{
+		public:
+			GLsync fence;
+			name_lists names;
+		};
+
+		// Delete every name in the lists, a type at a time
+		static void destroy_names(name_lists& names);
+
+	private:
+		std::array<handle_pool, types.size()> m_pools;
+		mutable state_cache m_state;
+
+		// Generated, but not yet handed to an identifier; taken from the back
+		name_lists m_spare;
+		// Released since the last end_frame
+		name_lists m_released;
+		std::deque<retired_names> m_retired;
 	};
 }
 
@@ -115,30 +178,31 @@ namespace hs
 {
 	template<GLenum T>
 	context::identifier<T>::identifier(context& c)
-		: bind_state<T>(name_adaptor<T>::create()), m_context{c}
+		: bind_state<T>(c.create_name<T>()), m_context{c}, m_handle{handle_pool::null_handle}
 	{
 		m_context.get().count_references(*this);
 	}
 
 	template<GLenum T>
 	context::identifier<T>::identifier(context& c, GLenum mode)
-		: bind_state<T>(name_adaptor<T>::create(), mode), m_context{c}
+		: bind_state<T>(c.create_name<T>(), mode), m_context{c}, m_handle{handle_pool::null_handle}
 	{
 		m_context.get().count_references(*this);
 	}
 
 	template<GLenum T>
 	context::identifier<T>::identifier(const identifier& other)
-		: bind_state<T>(other), m_context{other.m_context}
+		: bind_state<T>(other), m_context{other.m_context}, m_handle{other.m_handle}
 	{
 		m_context.get().increment_references(*this);
 	}
 
 	template<GLenum T>
 	context::identifier<T>::identifier(identifier&& other)
-		: bind_state<T>(other), m_context{other.m_context}
+		: bind_state<T>(other), m_context{other.m_context}, m_handle{other.m_handle}
 	{
 		other.m_name = 0;
+		other.m_handle = handle_pool::null_handle;
 	}
 
 	template<GLenum T>
@@ -148,39 +212,52 @@ namespace hs
 	}
 
 	template<GLenum T>
-	void context::count_references(const identifier<T>& i)
+	GLuint context::create_name()
+	{
+		auto& spare = m_spare[pool_index<T>()];
+		if (spare.empty())
+		{
+			spare.resize(name_batch<T>::value);
+			name_adaptor<T>::create(name_batch<T>::value, spare.data());
+
+			// Hand them out in the order GL made them
+			std::reverse(spare.begin(), spare.end());
+		}
+
+		auto name = spare.back();
+		spare.pop_back();
+
+		return name;
+	}
+
+	template<GLenum T>
+	void context::count_references(identifier<T>& i)
 	{
 		if (i.is_default())
 			return;
 
-		m_references.emplace(unique_name{T, i.name()}, 1);
+		i.m_handle = m_pools[pool_index<T>()].acquire(i.name());
 	}
 
 	template<GLenum T>
 	void context::increment_references(const identifier<T>& i)
 	{
-		if (i.is_default())
+		if (i.m_handle.is_null())
 			return;
 
-		auto& count = m_references.at({T, i.name()});
-		count += 1;
+		m_pools[pool_index<T>()].retain(i.m_handle);
 	}
 
 	template<GLenum T>
 	void context::decrement_references(const identifier<T>& i)
 	{
-		if (i.is_default())
+		if (i.m_handle.is_null())
 			return;
 
-		unique_name key{T, i.name()};
-
-		auto& count = m_references.at(key);
-		count -= 1;
+		auto& pool = m_pools[pool_index<T>()];
 
-		if (!count)
-		{
-			m_references.erase(key);
-			name_adaptor<T>::destroy(key.name);
-		}
+		auto name = pool.name(i.m_handle);
+		if (pool.release(i.m_handle))
+			m_released[pool_index<T>()].push_back(name);
 	}
 }
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "init.hpp"
+#include "window.hpp"
+
+namespace hs
+{
+	namespace backend
+	{
+		// A backend without any display, for servers and benchmarks
+		/* Uses a pbuffer surface where the driver has one, so the default framebuffer
+		* can still be drawn to and read back. Otherwise the context is surfaceless,
+		* and only framebuffer objects can be drawn to. Mesa's llvmpipe supports both
+		* through EGL_PLATFORM_SURFACELESS_MESA. Only built with HEATSINK_EGL
+		*/
+		namespace egl
+		{
+			void init(const settings& s);
+
+			class egl_window : public hs::window
+			{
+			public:
+				// The name is unused; kept so either backend can be constructed the same way
+				// With a frame limit, refresh asks to close after that many frames
+				egl_window(const std::string& name, glm::uvec2 size, size_t frame_limit = 0);
+
+				~egl_window();
+
+			public:
+				void make_active() const;
+				// There is nothing to present, so this only counts frames
+				bool refresh() const;
+
+				// Whether the default framebuffer exists
+				bool has_surface() const { return m_surface != nullptr; }
+
+			private:
+				// EGL handles are kept opaque so users of the header need no EGL headers
+				void* m_context;
+				void* m_surface;
+
+				size_t m_frame_limit;
+				mutable size_t m_frames;
+			};
+
+			using window = egl_window;
+		}
+	}
+}
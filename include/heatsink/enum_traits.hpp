@@ -128,6 +128,10 @@ namespace hs
 				return true;
 			case GL_SAMPLER_2D:
 				return true;
+			case GL_SAMPLER_2D_SHADOW:
+				return true;
+			case GL_SAMPLER_2D_ARRAY:
+				return true;
 			case GL_SAMPLER_3D:
 				return true;
 
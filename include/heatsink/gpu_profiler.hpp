@@ -0,0 +1,156 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+
+namespace hs
+{
+	// Time spent by the GPU and the CPU on named sections of each frame
+	/* Sections are bracketed with GL_TIMESTAMP queries, so they may nest. Queries
+	* are kept in a ring of frames and only read once a frame comes back around,
+	* when the GPU has long finished with it; results that are still not ready
+	* are dropped rather than waited on. Only needs GL 3.3 (ARB_timer_query)
+	*/
+	class gpu_profiler
+	{
+	public:
+		// Counters recorded for a section, combined as a bitmask
+		enum counter : unsigned
+		{
+			elapsed    = 1 << 0,
+			// GL_PRIMITIVES_GENERATED; sections counting these cannot nest
+			primitives = 1 << 1,
+			// GL_SAMPLES_PASSED; sections counting these cannot nest
+			samples    = 1 << 2
+		};
+		using counter_mask = unsigned;
+
+		// Frames of queries in flight before the oldest is read
+		static constexpr size_t default_latency = 4;
+		// Frames covered by the rolling statistics
+		static constexpr size_t window = 120;
+
+		// Statistics over the last few samples of a value
+		class rolling
+		{
+		public:
+			void add(double v);
+
+			double last() const;
+			double mean() const;
+			double min() const;
+			double max() const;
+
+			size_t count() const { return m_values.size(); }
+
+		private:
+			std::vector<double> m_values;
+			size_t m_next = 0;
+		};
+
+		struct section
+		{
+		public:
+			std::string name;
+
+			// Times are in milliseconds
+			rolling gpu;
+			rolling cpu;
+			rolling primitives;
+			rolling samples;
+		};
+
+		// Bracket a section for the lifetime of the scope
+		class scope
+		{
+		public:
+			scope(gpu_profiler& p, const std::string& name, counter_mask counters = elapsed)
+				: m_profiler{p} { m_profiler.begin(name, counters); }
+			~scope() { m_profiler.end(); }
+
+			scope(const scope&) = delete;
+			scope& operator =(const scope&) = delete;
+
+		private:
+			gpu_profiler& m_profiler;
+		};
+
+	public:
+		// Only the counters in the mask are ever recorded, whatever a section asks for
+		gpu_profiler(counter_mask enabled = elapsed | primitives | samples, size_t latency = default_latency);
+		~gpu_profiler();
+
+		gpu_profiler(const gpu_profiler&) = delete;
+		gpu_profiler& operator =(const gpu_profiler&) = delete;
+
+	public:
+		// Read the frame that is coming back around and reuse its queries
+		// Call once per frame, before any section
+		void begin_frame();
+
+		void begin(const std::string& name, counter_mask counters = elapsed);
+		void end();
+
+		// Sections in order of first use
+		const std::vector<section>& sections() const { return m_sections; }
+		// Sections whose results were not ready when their frame came back around
+		size_t dropped() const { return m_dropped; }
+
+		// A line per section with its mean GPU and CPU time and counters, then the dropped count
+		void report(std::ostream& out) const;
+		// The same as comma separated values, with a header
+		void write_csv(std::ostream& out) const;
+
+	private:
+		struct record
+		{
+		public:
+			size_t section;
+			counter_mask counters;
+
+			// Queries are only valid for the counters recorded
+			GLuint begin;
+			GLuint end;
+			GLuint primitives;
+			GLuint samples;
+
+			std::chrono::steady_clock::time_point cpu_begin;
+			double cpu;
+		};
+
+		struct frame
+		{
+		public:
+			std::vector<record> records;
+
+			// Query names are kept and reused each time the ring comes around
+			std::vector<GLuint> queries;
+			size_t used = 0;
+		};
+
+	private:
+		GLuint next_query();
+		// Add the results of a frame, if every query is ready
+		void collect(frame& f);
+
+	private:
+		counter_mask m_enabled;
+
+		std::vector<frame> m_frames;
+		size_t m_current;
+
+		std::vector<section> m_sections;
+		std::unordered_map<std::string, size_t> m_indices;
+
+		// Indices of the open records in the current frame
+		std::vector<size_t> m_open;
+		bool m_counting;
+
+		size_t m_dropped;
+	};
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+namespace hs
+{
+	// Reference counts for GL names, addressed by handle rather than looked up by name
+	/* Slots live in one dense array and are reused through a free list, so every
+	* operation is an index. A handle also carries the generation of its slot,
+	* so a handle kept past its release is caught instead of counting against
+	* whichever name reuses the slot
+	*/
+	class handle_pool
+	{
+	public:
+		struct handle
+		{
+		public:
+			bool is_null() const { return (index == null_index); }
+
+		public:
+			std::uint32_t index;
+			std::uint32_t generation;
+		};
+
+		static constexpr std::uint32_t null_index = UINT32_MAX;
+		static constexpr handle null_handle{null_index, 0};
+
+	public:
+		handle_pool();
+
+	public:
+		// Start counting a new name, with a single reference
+		handle acquire(GLuint name);
+		void retain(handle h);
+		// Drop a reference; returns true if it was the last, and the slot is now free
+		bool release(handle h);
+
+		GLuint name(handle h) const;
+
+		// Names with at least one reference
+		size_t live() const { return m_live; }
+
+	private:
+		struct slot
+		{
+		public:
+			GLuint name;
+			std::uint32_t references;
+			std::uint32_t generation;
+		};
+
+		slot& get(handle h);
+		const slot& get(handle h) const;
+
+	private:
+		std::vector<slot> m_slots;
+		std::vector<std::uint32_t> m_free;
+
+		size_t m_live;
+	};
+}
@@ -21,4 +21,11 @@ namespace hs
 		// Forward-compatibility only; required by OSX
 		bool forward_only;
 	};
+
+	namespace backend
+	{
+		// Load the GL entry points; safe to call more than once
+		// Each backend calls this once its first context is current
+		void load_functions();
+	}
 }
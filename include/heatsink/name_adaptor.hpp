@@ -9,10 +9,10 @@ namespace hs
 	template<GLenum>
 	struct name_adaptor
 	{
-		// Call the appropriate glCreate*() function
-		static GLuint create();
-		// Call the appropriate glDestroy*() function
-		static void destroy(GLuint name);
+		// Call the appropriate glGen*() function for count names at once
+		static void create(GLsizei count, GLuint* names);
+		// Call the appropriate glDelete*() function for count names at once
+		static void destroy(GLsizei count, const GLuint* names);
 
 		// A name may require a mode or a unit
 		static void bind(GLuint name);
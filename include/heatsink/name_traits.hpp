@@ -13,6 +13,10 @@ namespace hs
 	// Defined if the GL type requires a "slot" index when binding
 	template<GLenum>
 	struct has_bind_unit : std::false_type {};
+
+	// How many names of the GL type a context generates at once
+	template<GLenum>
+	struct name_batch : std::integral_constant<GLsizei, 32> {};
 }
 
 namespace hs
@@ -31,4 +35,8 @@ namespace hs
 
 	template<>
 	struct has_bind_unit<GL_TEXTURE> : std::true_type {};
+
+	// Programs are created one at a time, so there is nothing to gain from spares
+	template<>
+	struct name_batch<GL_PROGRAM> : std::integral_constant<GLsizei, 1> {};
 }
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <GL/glew.h>
+#include "context.hpp"
+#include "shader.hpp"
+#include "stream_buffer.hpp"
+#include "vertex_array.hpp"
+
+namespace hs
+{
+	// Collect the draws of a frame and issue them in an order that minimizes state changes
+	class render_queue
+	{
+	public:
+		// Everything needed to issue one draw call
+		/* Per-draw transforms and colors are vertex or instance attributes, so
+		* they are sourced through the vertex array rather than stored here
+		*/
+		struct packet
+		{
+		public:
+			size_t pass;
+
+			shader* program;
+			// Must have an element buffer set
+			const vertex_array* state;
+
+			GLenum primitive;
+			GLuint first;
+			GLsizei count;
+			GLint base_vertex;
+			GLuint base_instance;
+			GLsizei instances;
+		};
+
+	private:
+		// Layout read by glMultiDrawElementsIndirect
+		struct indirect_command
+		{
+		public:
+			GLuint count;
+			GLuint instances;
+			GLuint first;
+			GLint base_vertex;
+			GLuint base_instance;
+		};
+
+	public:
+		render_queue(context& c);
+
+	public:
+		void push(const packet& p);
+
+		// Issue every packet of a pass in key order
+		// Consecutive packets sharing a program and vertex array are a single multi-draw
+		void submit(size_t pass);
+
+		// Drop all packets; call at the start of each frame
+		void clear();
+
+		size_t size() const { return m_packets.size(); }
+
+		// Frames that had to wait for the GPU before writing draw commands
+		size_t stalls() const { return m_stalls + m_commands->stalls(); }
+
+	private:
+		// Packed as pass:8 | program:24 | vertex array:32, most significant first
+		static std::uint64_t make_key(const packet& p);
+
+		// Sort every pass and write all of their commands to the next region at once
+		void prepare();
+
+	private:
+		std::vector<std::pair<std::uint64_t, packet>> m_packets;
+
+		// Commands are stored in the same order as the sorted packets
+		std::vector<indirect_command> m_command_data;
+		// Replaced by a larger stream when a frame outgrows a region
+		std::unique_ptr<stream_buffer> m_commands;
+		std::reference_wrapper<context> m_context;
+		// Stalls of the streams that were replaced
+		size_t m_stalls;
+
+		bool m_prepared;
+	};
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <GL/glew.h>
+#include "context.hpp"
+
+namespace hs
+{
+	// Sampling parameters kept apart from any texture
+	// Bound to a texture unit, a sampler overrides the parameters of the texture there
+	class sampler : public context::identifier<GL_SAMPLER>
+	{
+	public:
+		sampler(context& c)
+			: context::identifier<GL_SAMPLER>(c) {}
+
+	public:
+		void set_filter(GLenum min, GLenum mag);
+		void set_wrap(GLenum s, GLenum t);
+		// Only used with GL_CLAMP_TO_BORDER wrapping
+		void set_border(const glm::vec4& color);
+
+		// Compare lookups of a depth texture against a reference value
+		// The result is the fraction of texels passing; GL_NONE returns the depth instead
+		/* With GL_LINEAR filtering the comparison is done on the four nearest
+		* texels and blended, which gives a 2x2 PCF for the cost of one lookup
+		*/
+		void set_compare(GLenum func);
+	};
+}
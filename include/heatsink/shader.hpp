@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <cassert>
 #include <string>
 #include <unordered_map>
@@ -14,8 +15,24 @@ namespace hs
 {
 	// Manages the state of an OpenGL shader program
 	// The class is called shader, but is actually what OpenGL calls a "program"
+	/* Linking is left running when the constructor returns, and only waited on
+	* when the program is first used, so a driver with parallel compilation can
+	* build every program at once. With a binary cache set, linked programs are
+	* saved, and later loaded instead of compiled while the sources and driver
+	* stay the same
+	*/
+	// Sources may #include other files, and be specialized with #defines (see shader_permutations)
 	class shader : public context::identifier<GL_PROGRAM>
 	{
+	public:
+		// How the programs created so far were built
+		struct cache_statistics
+		{
+		public:
+			size_t loaded;
+			size_t compiled;
+		};
+
 	public:
 		// Represents a single compilation unit of an OpenGL shader program
 		// What OpenGL actually refers to as a "shader"
@@ -34,6 +51,7 @@ namespace hs
 
 		public:
 			// Load the shader source from the file path and store it
+			// #include "file" lines are replaced by that file, relative to the including one
 			stage(const std::string& path)
 				: stage(path, deduce_name(path))
 			{
@@ -47,11 +65,38 @@ namespace hs
 			GLenum kind;
 		};
 
+		// A uniform location resolved ahead of time
+		// Setting through a handle skips the name lookup; T is checked when compiling
+		template<typename T>
+		class uniform_handle
+		{
+		public:
+			friend class shader;
+
+		public:
+			// A default handle refers to no uniform, and must not be set
+			uniform_handle()
+				: m_location{-1}, m_size{0} {}
+
+		private:
+			uniform_handle(GLint location, GLsizei size)
+				: m_location{location}, m_size{size} {}
+
+		public:
+			bool is_valid() const { return (m_location != -1); }
+
+		private:
+			GLint m_location;
+			GLsizei m_size;
+		};
+
 	private:
 		struct uniform
 		{
 			GLenum type;
 			GLuint location;
+			// Number of elements, if the uniform is an array
+			GLsizei size;
 		};
 
 	private:
@@ -60,16 +105,38 @@ namespace hs
 		// Should only be called when GL_LINK_STATUS is not true
 		static std::string get_program_error(GLuint id);
 
+	public:
+		// Save and load program binaries in a directory; an empty path disables the cache
+		static void set_binary_cache(const std::string& directory);
+		static cache_statistics get_cache_statistics();
+
 	public:
 		/* Stages can be implicitly constructed from std::string, but to create
 		* a vector of them, the literal operator "..."s from
 		* std::string_literals to allow for implicit construction
 		*/
-		shader(context& c, const std::vector<stage>& stages);
+		// Each define is a "NAME" or "NAME value" placed after the #version line of every stage
+		shader(context& c, const std::vector<stage>& stages, const std::vector<std::string>& defines = {});
+
+		// Waits for the original to finish linking, so both share a linked program
+		shader(const shader& other);
+		shader(shader&& other) = default;
+
+		~shader();
 
 	public:
+		// Wait for linking, if it is still running, before binding
+		void bind() const;
+		// Wait for linking, and check that it succeeded
+		// Called on first use; only needed to control when the wait happens
+		void finish_link() const;
+
+		// Whether the program was built with a define of this name, with or without a value
+		bool is_defined(const std::string& name) const;
+
+		// Declarations wait for linking to finish
 		template<typename T>
-		void declare_uniform(const std::string& name);
+		uniform_handle<T> declare_uniform(const std::string& name);
 
 		/* Two separate functions must be used, rather than providing a
 		* default initialization for "T value" since a shader uniform
@@ -77,27 +144,56 @@ namespace hs
 		* to a value of T could override that default
 		*/
 		template<typename T>
-		void declare_uniform(const std::string& name, const T& value);
+		uniform_handle<T> declare_uniform(const std::string& name, const T& value);
+
+		// Read a uniform block from whichever uniform_buffer is bound to binding
+		// T is the block's layout on the CPU; its size must match the std140 block
+		template<typename T>
+		void declare_uniform_block(const std::string& name, size_t binding);
 
 		/* Uniform functions must be defined as individual specializations,
 		* as each glUniform* function is too different to be combined
 		*/
 		template<typename T>
 		void set_uniform(const std::string& name, const T& v) const;
+		// Set the leading elements of a uniform array
+		template<typename T, size_t N>
+		void set_uniform(const std::string& name, const std::array<T, N>& v) const;
+
+		// Handles are used for uniforms set once or more per draw
+		template<typename T>
+		void set_uniform(uniform_handle<T> h, const T& v) const;
+		template<typename T, size_t N>
+		void set_uniform(uniform_handle<T> h, const std::array<T, N>& v) const;
 
 	private:
-		void set_uniform_raw(GLuint i, GLenum type, const void* p) const;
+		void set_uniform_raw(GLuint i, GLenum type, const void* p, GLsizei count = 1) const;
+
+		// Link from a cached binary; false if there is none, or the driver rejects it
+		bool load_binary();
+		void save_binary() const;
 
 	private:
 		std::unordered_map<std::string, uniform> m_uniforms;
+
+		// Stages still attached while linking runs
+		mutable std::vector<GLuint> m_stages;
+		mutable bool m_linked;
+
+		// The binary's file in the cache, or empty if there is no cache
+		std::string m_cache_path;
+
+		std::vector<std::string> m_defines;
 	};
 }
 
 namespace hs
 {
 	template<class T>
-	void shader::declare_uniform(const std::string& name)
+	shader::uniform_handle<T> shader::declare_uniform(const std::string& name)
 	{
+		finish_link();
+
 		GLint loc{glGetUniformLocation(this->m_name, name.c_str())};
 		assert(loc != -1);
 
@@ -116,19 +212,37 @@ namespace hs
 		GLenum type;
 		glGetActiveUniform(this->m_name, index, 0, nullptr, &size, &type, nullptr);
 
-		// FIXME: uniform array types are not yet supported
-		assert(size == 1);
+		// Arrays report the type of a single element
+		assert(size >= 1);
 		// Opaque types have their own enum, but are set as GLints
 		assert(is_opaque(type) ? utype == GL_INT : utype == type);
 
-		m_uniforms.emplace(name, uniform{utype, uloc});
+		m_uniforms.emplace(name, uniform{utype, uloc, size});
+		return uniform_handle<T>(loc, size);
+	}
+
+	template<class T>
+	shader::uniform_handle<T> shader::declare_uniform(const std::string& name, const T& value)
+	{
+		auto h = declare_uniform<T>(name);
+		set_uniform(h, value);
+
+		return h;
 	}
 
 	template<class T>
-	void shader::declare_uniform(const std::string& name, const T& value)
+	void shader::declare_uniform_block(const std::string& name, size_t binding)
 	{
-		declare_uniform<T>(name);
-		set_uniform(name, value);
+		finish_link();
+
+		GLuint index{glGetUniformBlockIndex(this->m_name, name.c_str())};
+		assert(index != GL_INVALID_INDEX);
+
+		GLint size;
+		glGetActiveUniformBlockiv(this->m_name, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+		assert(static_cast<size_t>(size) == sizeof(T));
+
+		glUniformBlockBinding(this->m_name, index, binding);
 	}
 
 	template<class T>
@@ -140,4 +254,33 @@ namespace hs
 		// FIXME: not the best way to acquire a pointer to the data
 		set_uniform_raw(u.location, u.type, reinterpret_cast<const void*>(&v));
 	}
+
+	template<class T, size_t N>
+	void shader::set_uniform(const std::string& name, const std::array<T, N>& v) const
+	{
+		const auto& u = m_uniforms.at(name);
+		assert(u.type == make_enum<component_decay_t<T>>{});
+		assert(N <= static_cast<size_t>(u.size));
+
+		set_uniform_raw(u.location, u.type, reinterpret_cast<const void*>(v.data()), N);
+	}
+
+	template<class T>
+	void shader::set_uniform(uniform_handle<T> h, const T& v) const
+	{
+		assert(h.is_valid());
+
+		GLenum type = make_enum<component_decay_t<T>>{};
+		set_uniform_raw(h.m_location, type, reinterpret_cast<const void*>(&v));
+	}
+
+	template<class T, size_t N>
+	void shader::set_uniform(uniform_handle<T> h, const std::array<T, N>& v) const
+	{
+		assert(h.is_valid());
+		assert(N <= static_cast<size_t>(h.m_size));
+
+		GLenum type = make_enum<component_decay_t<T>>{};
+		set_uniform_raw(h.m_location, type, reinterpret_cast<const void*>(v.data()), N);
+	}
 }
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "context.hpp"
+#include "shader.hpp"
+
+namespace hs
+{
+	// The variants of one program, each specialized by a set of #defines
+	/* Bit i of a feature mask defines features[i] in every stage, so a variant
+	* only contains the code its draws use. Variants are built the first time
+	* they are requested and kept for the life of the set; their addresses
+	* never change, so they can be held by a render_queue
+	*/
+	class shader_permutations
+	{
+	public:
+		using feature_mask = std::uint32_t;
+		// Called once for each variant before it is returned, eg, to declare its uniforms
+		using setup_function = std::function<void(shader&)>;
+
+	public:
+		// Defines are given to every variant, in front of the features
+		shader_permutations(context& c, const std::vector<shader::stage>& stages,
+			const std::vector<std::string>& features, const std::vector<std::string>& defines, setup_function setup);
+
+	public:
+		// Start building variants without waiting for them, so the driver can link them together
+		void prepare(std::initializer_list<feature_mask> masks);
+		// Build the variant if needed, and wait for it to link
+		shader& get(feature_mask features);
+
+		// Variants built so far
+		size_t size() const { return m_variants.size(); }
+
+	private:
+		struct variant
+		{
+		public:
+			shader program;
+			// Whether setup has run
+			bool ready;
+		};
+
+		variant& find_or_build(feature_mask features);
+
+	private:
+		std::reference_wrapper<context> m_context;
+		std::vector<shader::stage> m_stages;
+
+		std::vector<std::string> m_features;
+		std::vector<std::string> m_defines;
+		setup_function m_setup;
+
+		std::unordered_map<feature_mask, variant> m_variants;
+	};
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+
+namespace hs
+{
+	// A shadow of the GL binding state of a single context
+	// name_adaptor consults the cache of the current context to skip binds
+	// that would not change anything
+	class state_cache
+	{
+	public:
+		// Binds made and skipped since the last reset
+		struct statistics
+		{
+			size_t issued;
+			size_t elided;
+		};
+
+	public:
+		// The cache of the context active on the calling thread, if any
+		static state_cache* current();
+		// Called by a window when its context is made active
+		static void make_current(state_cache& c);
+
+	public:
+		state_cache();
+
+		state_cache(const state_cache&) = delete;
+		state_cache& operator =(const state_cache&) = delete;
+
+	public:
+		// Each method records the new binding and returns true
+		// if the caller must still make the GL call
+		bool use_program(GLuint name);
+		bool bind_vertex_array(GLuint name);
+		bool bind_buffer(GLenum mode, GLuint name);
+		bool bind_framebuffer(GLenum mode, GLuint name);
+		bool active_texture(size_t unit);
+		bool bind_texture(size_t unit, GLenum mode, GLuint name);
+		bool bind_sampler(size_t unit, GLuint name);
+
+		// Indexed binds also replace the generic binding of mode
+		void bind_buffer_base(GLenum mode, GLuint name);
+
+		// Drop every binding of a deleted name; GL may reset it behind our back
+		void forget(GLenum type, GLuint name);
+		// Drop all bindings; use after code outside heatsink has touched GL state
+		void invalidate();
+
+		const statistics& stats() const { return m_stats; }
+		void reset_stats() { m_stats = {0, 0}; }
+
+	private:
+		// Count the outcome of a bind; returns whether the call is needed
+		bool record(GLuint& bound, GLuint name);
+
+	private:
+		// A binding that is not known; never equal to a real name
+		static constexpr GLuint unknown = static_cast<GLuint>(-1);
+
+		GLuint m_program;
+		GLuint m_vertex_array;
+		GLuint m_draw_framebuffer;
+		GLuint m_read_framebuffer;
+
+		size_t m_active_unit;
+
+		std::unordered_map<GLenum, GLuint> m_buffers;
+		// Texture bindings of each unit, by target
+		std::vector<std::unordered_map<GLenum, GLuint>> m_textures;
+		std::vector<GLuint> m_samplers;
+
+		statistics m_stats;
+	};
+}
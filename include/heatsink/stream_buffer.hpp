@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cassert>
+#include <cstring>
+#include <iterator>
+#include <typeindex>
+#include <vector>
+
+#include <GL/glew.h>
+#include "array_buffer.hpp"
+#include "context.hpp"
+
+namespace hs
+{
+	// An array_buffer for data rewritten every frame, mapped once for the buffer's lifetime
+	/* The storage is split into regions of equal capacity, and each frame writes
+	* to the next one in turn. When a region is left, a fence is placed behind the
+	* commands that read it; the CPU only waits on that fence if it comes back
+	* around to the region before the GPU has finished with it. The size of the
+	* storage never changes - a larger capacity needs a new stream_buffer
+	*/
+	class stream_buffer : public array_buffer
+	{
+	public:
+		// Enough for the CPU to run two frames ahead of the GPU
+		static constexpr size_t default_regions = 3;
+
+	public:
+		// Create a stream_buffer holding capacity elements of T in each region
+		// Needed because constructor template arguments cannot be explicit
+		template<class T>
+		static stream_buffer empty(context& c, GLenum mode, size_t capacity, size_t regions = default_regions);
+
+		stream_buffer(const stream_buffer&) = delete;
+		stream_buffer(stream_buffer&& other);
+
+		~stream_buffer();
+
+	private:
+		// Utility for stream_buffer::empty
+		template<class T>
+		stream_buffer(context& c, GLenum mode, size_t capacity, size_t regions, T*);
+
+	public:
+		// Fence the current region and move to the next, which starts empty
+		// Call once per frame, after every command reading the current region was issued
+		void next_region();
+
+		// Append elements to the current region, and return the index of the first
+		// Indices count from the start of the region; see region_offset
+		template<class Iterator>
+		size_t write(Iterator begin, Iterator end);
+
+		// The storage is immutable, so it can only be written through write
+		template<class Iterator>
+		void update(Iterator begin, Iterator end) = delete;
+
+		// Elements in every region together
+		size_t size() const { return m_capacity * m_fences.size(); }
+		// Elements that fit in a single region
+		size_t capacity() const { return m_capacity; }
+		// Elements written to the current region
+		size_t used() const { return m_used; }
+		// Byte offset of the current region from the start of the buffer
+		size_t region_offset() const { return m_region * m_capacity * this->stride(); }
+
+		// Times next_region had to wait for the GPU
+		size_t stalls() const { return m_stalls; }
+
+	private:
+		// Allocate immutable storage and map all of it
+		void allocate();
+
+	private:
+		size_t m_capacity;
+		size_t m_used;
+
+		// Fences are null until a region is first left
+		std::vector<GLsync> m_fences;
+		size_t m_region;
+		size_t m_stalls;
+
+		char* m_data;
+	};
+}
+
+namespace hs
+{
+	template<class T>
+	stream_buffer stream_buffer::empty(context& c, GLenum mode, size_t capacity, size_t regions)
+	{
+		return stream_buffer(c, mode, capacity, regions, (T*)0);
+	}
+
+	template<class T>
+	stream_buffer::stream_buffer(context& c, GLenum mode, size_t capacity, size_t regions, T*)
+		: array_buffer(c, mode, GL_STREAM_DRAW, (T*)0), m_capacity{capacity}, m_used{0},
+		  m_fences(regions, nullptr), m_region{0}, m_stalls{0}, m_data{nullptr}
+	{
+		assert(capacity && regions);
+		allocate();
+	}
+
+	template<class Iterator>
+	size_t stream_buffer::write(Iterator begin, Iterator end)
+	{
+		using tag_type = typename std::iterator_traits<Iterator>::iterator_category;
+		assert((std::is_same<tag_type, std::random_access_iterator_tag>::value));
+
+		using value_type = typename std::iterator_traits<Iterator>::value_type;
+		assert(std::type_index(typeid(value_type)) == this->get_type());
+
+		auto first = m_used;
+		auto count = static_cast<size_t>(std::distance(begin, end));
+		assert(first + count <= m_capacity);
+
+		// Coherent storage needs no flush; the GPU sees the writes with the next command
+		if (count)
+			std::memcpy(m_data + region_offset() + first * sizeof(value_type), &(*begin), count * sizeof(value_type));
+
+		m_used += count;
+		return first;
+	}
+}
@@ -70,6 +70,9 @@ namespace hs
 	public:
 		void resize(dimension_type size) { m_size = size; }
 		void reserve(target t);
+		// Allocate immutable storage for the given number of mipmap levels at once
+		// Array textures keep the same number of layers at every level
+		void allocate(GLenum storage, size_t levels);
 
 		template<class Iterator>
 		void update(source s, target t, Iterator begin, Iterator end);
@@ -83,6 +86,8 @@ namespace hs
 		size_t data_size(GLenum format, size_t level = 0) const;
 
 		void set_filter(GLenum min, GLenum mag);
+		// Rebuild every level below 0 from level 0, eg, after rendering to it
+		void generate_mipmaps();
 
 	private:
 		void set_data(source s, target t, const void* data);
@@ -118,6 +123,26 @@ namespace hs
 		set_data(s, t, nullptr);
 	}
 
+	template<size_t N>
+	void texture<N>::allocate(GLenum storage, size_t levels)
+	{
+		assert(levels > 0);
+
+		bind_to(0);
+		switch (N)
+		{
+			case 1:
+				glTexStorage1D(this->m_mode, levels, storage, m_size[0]);
+				break;
+			case 2:
+				glTexStorage2D(this->m_mode, levels, storage, m_size[0], m_size[1]);
+				break;
+			case 3:
+				glTexStorage3D(this->m_mode, levels, storage, m_size[0], m_size[1], m_size[2]);
+				break;
+		}
+	}
+
 	template<size_t N> template<class Iterator>
 	void texture<N>::update(source s, target t, Iterator begin, Iterator end)
 	{
@@ -193,6 +218,13 @@ namespace hs
 		glTexParameteri(this->m_mode, GL_TEXTURE_MAG_FILTER, mag);
 	}
 
+	template<size_t N>
+	void texture<N>::generate_mipmaps()
+	{
+		bind_to(0);
+		glGenerateMipmap(this->m_mode);
+	}
+
 	template<size_t N>
 	void texture<N>::set_data(source s, target t, const void* data)
 	{
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cassert>
+#include <typeindex>
+
+#include <GL/glew.h>
+#include "context.hpp"
+
+namespace hs
+{
+	// A buffer holding the data of a single GLSL uniform block
+	// T must match the block's std140 layout, including any padding
+	class uniform_buffer : public context::identifier<GL_BUFFER>
+	{
+	public:
+		// Create a new uniform_buffer with no data
+		// Needed because constructor template arguments cannot be explicit
+		template<class T>
+		static uniform_buffer empty(context& c, GLenum usage = GL_DYNAMIC_DRAW);
+
+	public:
+		template<class T>
+		uniform_buffer(context& c, const T& data, GLenum usage = GL_DYNAMIC_DRAW);
+
+	private:
+		// Utility for uniform_buffer::empty
+		// Allocate storage for T without specifying valid data
+		template<class T>
+		uniform_buffer(context& c, GLenum usage, T*);
+
+	public:
+		template<class T>
+		void update(const T& data);
+
+		// Attach to an indexed binding point; every program with a block
+		// declared at the same binding will read from this buffer
+		void bind_base(size_t binding) const;
+
+		size_t size() const { return m_size; }
+		GLenum usage() const { return m_usage; }
+
+		const std::type_index get_type() const { return m_type; }
+
+	private:
+		size_t m_size;
+		GLenum m_usage;
+
+		std::type_index m_type;
+	};
+}
+
+namespace hs
+{
+	template<class T>
+	uniform_buffer uniform_buffer::empty(context& c, GLenum usage)
+	{
+		return uniform_buffer(c, usage, (T*)0);
+	}
+
+	template<class T>
+	uniform_buffer::uniform_buffer(context& c, const T& data, GLenum usage)
+		: uniform_buffer(c, usage, (T*)0)
+	{
+		update(data);
+	}
+
+	template<class T>
+	uniform_buffer::uniform_buffer(context& c, GLenum usage, T*)
+		: context::identifier<GL_BUFFER>(c, GL_UNIFORM_BUFFER), m_size{sizeof(T)}, m_usage{usage}, m_type{typeid(T)}
+	{
+		// The size never changes, so storage is only allocated once
+		bind();
+		glBufferData(this->m_mode, m_size, nullptr, m_usage);
+	}
+
+	template<class T>
+	void uniform_buffer::update(const T& data)
+	{
+		assert(std::type_index(typeid(T)) == m_type);
+
+		bind();
+		glBufferSubData(this->m_mode, 0, m_size, &data);
+	}
+}
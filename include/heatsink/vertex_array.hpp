@@ -20,8 +20,9 @@ namespace hs
 			{
 			}
 			// Component will be automatically inferred if GL_NONE
-			attribute(size_t i, bool n, GLenum c = GL_NONE)
-				: index{i}, normalize{n}, component{c}
+			// A non-zero divisor advances the attribute per instance instead of per vertex
+			attribute(size_t i, bool n, GLenum c = GL_NONE, size_t d = 0)
+				: index{i}, normalize{n}, component{c}, divisor{d}
 			{
 			}
 
@@ -29,18 +30,20 @@ namespace hs
 			size_t index;
 			bool normalize;
 			GLenum component;
+			size_t divisor;
 		};
 
 	public:
 		vertex_array(context& c)
-			: context::identifier<GL_VERTEX_ARRAY>(c) {}
+			: context::identifier<GL_VERTEX_ARRAY>(c), m_indexing{GL_NONE} {}
 
 	public:
-		// Set part of an array_buffer as an attribute
+		// Set part of an array_buffer as an attribute, starting from element first
 		// Member pointer class must be same as what was stored in the buffer
 		template<class T, class C>
-		void set_attribute(attribute a, const array_buffer& b, T C::*field);
+		void set_attribute(attribute a, const array_buffer& b, T C::*field, size_t first = 0);
 		// Set an entire array_buffer as an attribute
+		// Each element must fit a single attribute index; set matrices through a field
 		void set_attribute(attribute a, const array_buffer& b);
 
 		// Set an array_buffer as the indexing attribute
@@ -49,6 +52,10 @@ namespace hs
 		// Return indexing mode if set_elements has been called, or GL_NONE
 		GLenum indexing() const { return m_indexing; }
 
+	private:
+		// Matrix types take one attribute index per column, starting at a.index
+		void set_pointer(attribute a, const array_buffer& b, size_t columns, size_t size, size_t stride, size_t offset);
+
 	private:
 		GLenum m_indexing;
 	};
@@ -57,7 +64,7 @@ namespace hs
 namespace hs
 {
 	template<class T, class C>
-	void vertex_array::set_attribute(attribute a, const array_buffer& b, T C::*field)
+	void vertex_array::set_attribute(attribute a, const array_buffer& b, T C::*field, size_t first)
 	{
 		assert(b.mode() == GL_ARRAY_BUFFER);
 		assert(b.get_type() == std::type_index(typeid(C)));
@@ -68,22 +75,19 @@ namespace hs
 		// Component must be specified if it cannot be inferred
 		assert(a.component != GL_NONE);
 
+		// A matrix (eg, glm::mat4) is specified as sequential column vectors
+		constexpr size_t columns = (component_rank<T>::value > 1) ? component_extent<T>::value : 1;
+
 		auto component_size = enum_sizeof(a.component);
-		auto size = sizeof(T) / component_size;
-		// FIXME: support for sequential matrix attributes
-		assert(size <= 4);
+		auto size = sizeof(T) / component_size / columns;
 
 		/* Dereferencing a null pointer is undefined behavior, but it will work
 		* here - C should be a POD type, so the null pointer dereference is
 		* working in the same vein as offsetof(), just with a member pointer
 		*/
 		// FIXME: Could be made compliant by specifying a temporary C?
-		auto offset = (GLvoid*)((char*)&(((C*)nullptr)->*field) - (char*)nullptr);
-
-		bind();
-		glEnableVertexAttribArray(a.index);
+		auto offset = (size_t)((char*)&(((C*)nullptr)->*field) - (char*)nullptr);
 
-		b.bind();
-		glVertexAttribPointer(a.index, size, a.component, a.normalize, sizeof(C), offset);
+		set_pointer(a, b, columns, size, sizeof(C), first * sizeof(C) + offset);
 	}
 }
@@ -65,6 +65,10 @@ namespace helper
 
 	public:
 		assimp_model(const std::string& filename);
+		~assimp_model();
+
+		assimp_model(const assimp_model&) = delete;
+		assimp_model& operator =(const assimp_model&) = delete;
 
 	public:
 		template<typename V, typename I = GLuint>
@@ -94,18 +98,20 @@ auto helper::assimp_model::get_meshes() const -> std::vector<mesh<V, I>>
 		auto* src = m_scene->mMeshes[i];
 
 		std::vector<V> vertices;
-		//vertices.reserve(src->mNumVertices);
+		vertices.reserve(src->mNumVertices);
+
+		for (auto j = 0; j != src->mNumVertices; ++j)
+			vertices.emplace_back(*src, j);
 
-		//for (auto j = 0; j != src->mNumVertices; ++j)
-		//	vertices.emplace_back(*src, j);
+		// Meshes are triangulated on import; stray points and lines are dropped
+		std::vector<I> indices;
+		indices.reserve(src->mNumFaces * 3);
 
-		std::vector<I> indices(src->mNumFaces * 3);
 		for (auto j = 0; j != src->mNumFaces; ++j)
 		{
 			auto& f = src->mFaces[j];
-			for (auto k = 0; k != f.mNumIndices; ++k)
-				vertices.emplace_back(*src, f.mIndices[k]);
-			//std::copy(f.mIndices, f.mIndices + 3, indices.begin() + (j * 3));
+			if (f.mNumIndices == 3)
+				indices.insert(indices.end(), f.mIndices, f.mIndices + 3);
 		}
 
 		meshes.emplace_back(vertices, indices, src->mMaterialIndex);
@@ -16,6 +16,10 @@ namespace helper
 		stb_image(const std::string& filename, GLenum format = GL_NONE);
 		~stb_image();
 
+		// Images are decoded on loader threads and handed back through futures
+		stb_image(const stb_image&) = delete;
+		stb_image(stb_image&& other);
+
 	public:
 		glm::uvec2 size() const { return glm::uvec2(width, height); }
 		size_t data_size() const { return (width * height * component_size); }
@@ -3,9 +3,10 @@
 #include <functional>
 #include <glm/glm.hpp>
 #include <map>
-#include <openvr.h>
 #include <optional>
 
+#include <xr_runtime.hpp>
+
 namespace helper {
 	class vr_controller {
 	public:
@@ -20,26 +21,22 @@ namespace helper {
 		};
 
 	public:
-		vr_controller(vr::IVRSystem* hmd, vr::ETrackedControllerRole role);
+		vr_controller();
 		~vr_controller() = default;
 
 	public:
-		void update(const std::vector<vr::TrackedDevicePose_t>& poses);
+		// Read a copy of the hand latched by the runtime, so this need not run on the render thread
+		void update(const xr_device& device);
 	
 	public:
-		uint64_t get_index() const;
 		glm::mat4 get_model_matrix() const;
 	
 	public:
-		void attach_handler(vr::EVRButtonId id, handler h);
+		void attach_handler(xr_button id, handler h);
 		std::optional<glm::vec2> ray_intersect(const glm::vec3& origin, const glm::vec3& dir, const glm::vec3& pos, const glm::vec3& norm);
 
 	private:
-		vr::IVRSystem* m_hmd;
-		vr::ETrackedControllerRole m_role;
-
-		vr::TrackedDeviceIndex_t m_index;
-		std::map<uint64_t, button> m_handlers;
+		std::map<uint32_t, button> m_handlers;
 
 		glm::mat4 m_model;
 	};
@@ -1,12 +1,12 @@
 #pragma once
 
-#include <set>
 #include <string>
 
 #include <heatsink/context.hpp>
 #include <heatsink/shader.hpp>
 
 #include <audio.hpp>
+#include <loader.hpp>
 #include <model.hpp>
 
 class instrument
@@ -56,7 +56,9 @@ public:
 	instrument(hs::context& c, size_t voice, std::shared_ptr<audio::source> src);
 
 public:
-	void draw(hs::shader& s, const std::set<std::string>& unis);
+	// The shared model this instrument is drawn with, and its transform in it
+	std::shared_ptr<model> get_model() const { return m_model; }
+	model::instance get_instance() const;
 
 public:
 	glm::vec3 position() const { return m_position; }
@@ -69,7 +71,8 @@ public:
 	bool selected() const { return m_selected; }
 	void selected(bool s) { m_selected = s; }
 
-	static void init(hs::context& context, const std::vector<char>& channels);
+	// Queue the models for every family used by the given channel presets
+	static void init(loader& l, const std::vector<char>& channels);
 
 private:
 	family m_family;
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <helper/stb.hpp>
+
+#include <geometry_arena.hpp>
+#include <model.hpp>
+
+// Decode assets on a pool of worker threads
+// Only the GL uploads are left for the thread owning the context
+class loader
+{
+public:
+	loader(size_t threads = std::thread::hardware_concurrency());
+	~loader();
+
+	loader(const loader&) = delete;
+	loader& operator =(const loader&) = delete;
+
+public:
+	// Import a model in the background; duplicate paths are only decoded once
+	void queue_model(const std::string& path);
+	// Decode an image in the background
+	std::future<helper::stb_image> queue_image(const std::string& path, GLenum format = GL_NONE);
+	// Run any other decoding work in the background; fn must not touch GL
+	template<class Fn>
+	auto queue_task(Fn fn) -> std::future<std::invoke_result_t<Fn>> { return submit(std::move(fn)); }
+
+	// Wait for every queued model and add it to the arena and the model cache
+	// The arena is uploaded with its next flush, from the thread that owns the context
+	void upload_models(geometry_arena& arena);
+
+private:
+	template<class Fn>
+	auto submit(Fn fn) -> std::future<std::invoke_result_t<Fn>>;
+
+private:
+	std::vector<std::thread> m_workers;
+
+	std::queue<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_ready;
+	bool m_running;
+
+	std::map<std::string, std::future<std::vector<model::mesh_data>>> m_models;
+};
+
+template<class Fn>
+auto loader::submit(Fn fn) -> std::future<std::invoke_result_t<Fn>>
+{
+	// packaged_task is move-only, but std::function must be copyable
+	auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Fn>()>>(std::move(fn));
+	auto result = task->get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.emplace([task]() { (*task)(); });
+	}
+
+	m_ready.notify_one();
+	return result;
+}
@@ -1,16 +1,19 @@
 #pragma once
 
-#include <set>
+#include <functional>
 #include <vector>
 
 #include <glm/glm.hpp>
 
-#include <heatsink/array_buffer.hpp>
-#include <heatsink/vertex_array.hpp>
+#include <heatsink/render_queue.hpp>
 #include <heatsink/shader.hpp>
 
 #include <helper/assimp.hpp>
 
+#include <culling.hpp>
+
+class geometry_arena;
+
 class model
 {
 public:
@@ -30,32 +33,104 @@ public:
 	public:
 		glm::vec3 position;
 		glm::vec3 normal;
+		// The material color, so meshes need no uniforms and can share a draw
+		glm::vec3 color{1.f};
+	};
+
+	// Vertex attribute indices used by the instance data
+	static constexpr size_t first_instance_attribute = 2;
+	static constexpr size_t last_instance_attribute = 6;
+	static constexpr size_t color_attribute = 7;
+
+	// Per-instance data, a model is drawn once for each instance
+	struct instance
+	{
+	public:
+		glm::mat4 transform;
+		glm::vec3 tint{0.f};
 	};
 
+	// Bounding volumes in model space
+	struct bounds
+	{
+	public:
+		static bounds from_vertices(const std::vector<vertex>& verts);
+		// The smallest bounds containing both a and b
+		static bounds merge(const bounds& a, const bounds& b);
+
+	public:
+		glm::vec3 min;
+		glm::vec3 max;
+
+		// The sphere is centered on the box, so it may be slightly loose
+		glm::vec3 center;
+		float radius;
+	};
+
+	// Programs built with this define draw both eyes, side by side, in one pass
+	static constexpr const char* stereo_define = "STEREO";
+
+	// Instances drawn by a program for each model instance; one for each view
+	static size_t view_count(const hs::shader& shad) { return shad.is_defined(stereo_define) ? 2 : 1; }
+
+	// Most levels of detail generated for a mesh, including the original
+	static constexpr size_t max_lods = 4;
+	// Projected diameter, in pixels, below which an instance drops to its next level
+	// Each following level halves the threshold
+	static constexpr float full_detail_size = 400.f;
+
 	// Mesh Struct
+	// The geometry lives in a shared geometry_arena
 	struct mesh
 	{
 		using material_data = helper::assimp_model::material_data;
 
-		hs::array_buffer vertices;
-		hs::vertex_array state;
-		material_data    material;
-
-		mesh(hs::context& con, const std::vector<vertex>& verts, const material_data& mat) 
-		: vertices(con, GL_ARRAY_BUFFER, verts), state(con), material(mat)
+		// One level of detail; every level shares the base vertex
+		struct lod
 		{
-			state.set_attribute(0, vertices, &vertex::position);
-			state.set_attribute(1, vertices, &vertex::normal);
-		}
+			GLuint first_index;
+			GLsizei count;
+		};
+
+		GLint  base_vertex;
+		// Ordered from full detail to coarsest
+		std::vector<lod> lods;
+
+		model::bounds bounds;
+	};
+
+	// CPU-side copy of a mesh, decoded without touching GL
+	struct mesh_data
+	{
+		std::vector<vertex> vertices;
+		// Index lists for each level of detail, lods[0] being the original mesh
+		std::vector<std::vector<GLuint>> lods;
+		mesh::material_data material;
 	};
 
 private:
+	std::reference_wrapper<geometry_arena> m_arena;
+
+	// This frame's instances, and their bounding spheres in world space
+	std::vector<instance> m_instances;
+	sphere_set m_spheres;
+
+	// The union of every mesh's bounds
+	bounds m_bounds;
+
 	std::vector<mesh> m_meshes;
-	glm::vec3 m_position;
+	// The most levels of any mesh
+	size_t m_lod_count;
+
+	// Scratch space for queue, kept so that queueing a pass allocates nothing once warm
+	std::vector<unsigned char> m_visible;
+	// The visible instances at each level of detail
+	std::vector<std::vector<instance>> m_kept;
 
 public:
 	model() = delete;
-	model(hs::context& con, const std::string& modelPath);
+	model(geometry_arena& arena, const std::string& modelPath);
+	model(geometry_arena& arena, const std::vector<mesh_data>& meshes);
 	
 	model(const model&& other) = delete;
 	model(model&& other);
@@ -67,16 +142,31 @@ public:
 
 public:
 	static std::unordered_map<std::string, std::shared_ptr<model>> g_model_cache;
-	static std::shared_ptr<model> load_model(hs::context& context, const std::string& path);
+	static std::shared_ptr<model> load_model(geometry_arena& arena, const std::string& path);
 	static std::shared_ptr<model> get_model(const std::string& path);
 
+	// Read a model file into mesh_data, and simplify each mesh into its levels of detail
+	// Safe to call from any thread
+	static std::vector<mesh_data> import(const std::string& path);
+
 public:
 	// Accessors
-	glm::vec3 position() const { return m_position; }
+	size_t instance_count() const { return m_instances.size(); }
+	const bounds& get_bounds() const { return m_bounds; }
+	// The world space sphere around an instance; xyz is the center and w the radius
+	glm::vec4 bounding_sphere(const instance& i) const;
 
 	// Setters
-	void position(const glm::vec3& pos) { m_position = pos; }
+	// Replace every instance drawn by this model; call once per frame, before any draw
+	void instances(const std::vector<instance>& insts);
 
 	// Rendering methods
-	void draw(hs::shader& shad, const std::set<std::string>& unis, const glm::mat4& M = glm::mat4(1.f));
+	// Queue the instances touching any of the frustums, with a single draw per mesh
+	// An empty list of frustums queues every instance; see sphere_set::cull
+	// The visible instances are added to the arena, which must be flushed before submission
+	// The draws of every model sharing a program in a pass are merged
+	// A program built with stereo_define repeats each instance once per eye (see view.glsl)
+	// Each instance uses the level of detail matching its size under the given scale
+	void queue(hs::render_queue& q, size_t pass, hs::shader& shad,
+	           const std::vector<frustum>& view, const projection_scale& scale, cull_stats& stats);
 };
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <openvr.h>
+
+#include <xr_runtime.hpp>
+
+// A headset driven through SteamVR
+class openvr_runtime : public xr_runtime
+{
+public:
+	// Asserts that SteamVR and its compositor are running
+	openvr_runtime();
+	~openvr_runtime();
+
+	openvr_runtime(const openvr_runtime&) = delete;
+	openvr_runtime& operator =(const openvr_runtime&) = delete;
+
+public:
+	glm::uvec2 render_size() const;
+
+	void wait_frame();
+	// Predicts the head pose for the next vsync's photons, and submits with that pose
+	void latch();
+	void submit(GLuint texture);
+
+	const xr_device& head() const { return m_head; }
+	const xr_device& hand(xr_hand h) const { return m_hands[static_cast<size_t>(h)]; }
+
+	glm::mat4 projection(xr_eye e, float near_plane, float far_plane) const;
+	glm::mat4 eye_to_head(xr_eye e) const;
+
+	// Frames SteamVR presented, dropped and reprojected since launch
+	void report(std::ostream& out) const;
+
+private:
+	// Controllers may be switched on after launch, so each is looked for until found
+	void find_hand(xr_hand h);
+
+private:
+	vr::IVRSystem* m_system;
+	vr::IVRCompositor* m_compositor;
+
+	std::vector<vr::TrackedDevicePose_t> m_poses;
+	std::array<vr::TrackedDeviceIndex_t, 2> m_hand_index;
+
+	// The head pose the frame is drawn from, passed back to the compositor for reprojection
+	vr::HmdMatrix34_t m_head_tracking;
+
+	xr_device m_head;
+	std::array<xr_device, 2> m_hands;
+};
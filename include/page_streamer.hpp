@@ -0,0 +1,113 @@
+#pragma once
+
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <heatsink/context.hpp>
+#include <heatsink/stream_buffer.hpp>
+#include <heatsink/texture.hpp>
+
+#include <helper/stb.hpp>
+
+#include <loader.hpp>
+
+// Keep the pages of a score around the playback position resident in a texture array
+/* Pages are decoded, and their mipmaps built, on the loader's workers. Uploads
+* go through a streamed pixel buffer and are spread over frames, a fixed number
+* of bytes at a time, so a page turn never decodes or uploads a whole page at
+* once. Until the requested page is resident, the last page shown stays up.
+* A page that cannot be decoded, or is not the size of the first, is skipped,
+* and the one before it stays up in its place
+*/
+class page_streamer
+{
+public:
+	// Layers kept resident: the shown page, the ones after it and the one before
+	static constexpr size_t default_slots = 4;
+	// Bytes of page data uploaded per frame
+	static constexpr size_t upload_budget = 4 << 20;
+
+	// RGBA rows for each mipmap level, from full size down to 1x1
+	using mip_chain = std::vector<std::vector<unsigned char>>;
+
+public:
+	// Blocks until the first page, queued earlier with loader::queue_image, is decoded, and shows it
+	page_streamer(hs::context& c, loader& assets, const std::vector<std::string>& paths,
+	              std::future<helper::stb_image> first, size_t slots = default_slots);
+
+	page_streamer(const page_streamer&) = delete;
+	page_streamer& operator =(const page_streamer&) = delete;
+
+public:
+	// Ask for a page to be shown; it and the pages around it are prefetched
+	void request(size_t page);
+	// Collect decoded pages and continue uploading; call once per frame
+	void update();
+
+	// The texture layer holding the page being shown
+	GLint layer() const;
+
+	size_t page_count() const { return m_paths.size(); }
+	size_t shown() const { return m_shown; }
+	// Frames where the requested page was not yet resident
+	size_t misses() const { return m_misses; }
+
+	hs::texture3& get_texture() { return m_texture; }
+
+private:
+	// Pages to keep resident for the current request, most wanted first
+	std::vector<size_t> wanted() const;
+	// The slot holding a page, or m_slots.size() if it is not resident
+	size_t find_slot(size_t page) const;
+
+	// Start uploading the most wanted decoded page, if a slot can be given up for it
+	void start_upload();
+	// Copy up to the byte budget of the current upload into the texture
+	void continue_upload();
+
+private:
+	struct upload
+	{
+	public:
+		size_t page;
+		size_t slot;
+		mip_chain levels;
+
+		// The next row of the next level to copy
+		size_t level;
+		size_t row;
+	};
+
+	static constexpr size_t no_page = static_cast<size_t>(-1);
+
+private:
+	std::reference_wrapper<loader> m_loader;
+	std::vector<std::string> m_paths;
+
+	glm::uvec2 m_size;
+	size_t m_levels;
+
+	hs::texture3 m_texture;
+	hs::stream_buffer m_staging;
+
+	// The page in each layer, or no_page while it is empty or being uploaded
+	std::vector<size_t> m_slots;
+
+	std::map<size_t, std::future<mip_chain>> m_decoding;
+	std::map<size_t, mip_chain> m_decoded;
+	std::unique_ptr<upload> m_upload;
+	// Pages skipped by decode
+	std::set<size_t> m_failed;
+
+	size_t m_requested;
+	size_t m_shown;
+	size_t m_misses;
+};
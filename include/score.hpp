@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <map>
 #include <string>
 #include <TinySoundFont/tsf.h>
@@ -85,6 +86,11 @@ public:
 public:
 	bool is_playing() const;
 
+	// Milliseconds of the score played so far; pausing holds it, and stopping rewinds it
+	double position() const;
+	// Time of the last event, in milliseconds
+	double length() const { return m_length; }
+
 	void play();
 	void pause();
 	void stop();
@@ -95,4 +101,10 @@ private:
 	tml_message* m_messages;
 
 	bool m_playing;
+
+	// Time played before the last call to play, and when that call was made
+	double m_played;
+	std::chrono::steady_clock::time_point m_started;
+
+	double m_length;
 };
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// Reduce an indexed triangle list to about target_count indices by quadric edge collapse
+/* Vertices are only ever collapsed onto other existing vertices, so every level
+* of detail can share the original vertex buffer. Vertices on open borders are
+* never moved, so silhouettes of unclosed meshes keep their shape. Returns the
+* new indices; if the mesh cannot be reduced further, the result may be larger
+* than target_count
+*/
+std::vector<GLuint> simplify(const std::vector<glm::vec3>& positions, const std::vector<GLuint>& indices, size_t target_count);
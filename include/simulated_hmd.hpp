@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <xr_runtime.hpp>
+
+// A headset that plays back poses from a script, for running the frame loop without SteamVR
+/* Poses are sampled at the frame number over the refresh rate rather than the
+* wall clock, so every run of a script sees the same frames. A fake compositor
+* paces frames to the refresh rate like vsync, and counts a frame as missed for
+* every refresh that passes after its deadline before it is submitted
+*/
+class simulated_hmd : public xr_runtime
+{
+public:
+	struct settings
+	{
+	public:
+		// The size of one eye's image
+		glm::uvec2 render_size{1512, 1680};
+		// Zero runs as fast as frames are submitted, without pacing or misses
+		float refresh_rate = 90.f;
+
+		float vertical_fov = glm::radians(100.f);
+		float ipd = 0.064f;
+
+		// Wait for the GPU at submit, as a real compositor must before it can show the frame
+		bool wait_for_gpu = true;
+	};
+
+	// One sample of a device in a pose script
+	/* A script has one keyframe per line, as
+	*   time device px py pz qw qx qy qz buttons
+	* where device is head, left or right, and buttons are xr_button bits.
+	* Positions and orientations are interpolated; buttons hold until the
+	* next keyframe. Lines starting with # are ignored. The script loops
+	*/
+	struct keyframe
+	{
+	public:
+		double time;
+
+		glm::vec3 position;
+		glm::quat orientation;
+		std::uint32_t buttons;
+	};
+
+public:
+	// Plays a built-in script: looking around while conducting at 120bpm, starting playback after a second
+	explicit simulated_hmd(const settings& s);
+	simulated_hmd(const settings& s, std::istream& script);
+
+public:
+	glm::uvec2 render_size() const { return m_settings.render_size; }
+
+	void wait_frame();
+	void submit(GLuint texture);
+
+	const xr_device& head() const { return m_devices[0]; }
+	const xr_device& hand(xr_hand h) const { return m_devices[1 + static_cast<size_t>(h)]; }
+
+	glm::mat4 projection(xr_eye e, float near_plane, float far_plane) const;
+	glm::mat4 eye_to_head(xr_eye e) const;
+
+	// Frame times and missed frames
+	void report(std::ostream& out) const;
+
+	// Append the current poses of any runtime to a script, to play back later
+	static void record(std::ostream& out, double time, const xr_runtime& runtime);
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	// Length of one refresh; used as the pose time step even when unpaced
+	double period() const;
+
+	void sample(double time);
+
+private:
+	settings m_settings;
+
+	// Head, left hand and right hand
+	std::array<std::vector<keyframe>, 3> m_tracks;
+	std::array<xr_device, 3> m_devices;
+	double m_duration;
+
+	size_t m_frames;
+	size_t m_missed;
+
+	// The refresh the frame in flight started on, and the one it must be submitted by
+	clock::time_point m_frame_start;
+	clock::time_point m_deadline;
+	clock::time_point m_next_refresh;
+	bool m_started;
+
+	// Wait to submit, in milliseconds
+	double m_total_time;
+	double m_max_time;
+};
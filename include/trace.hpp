@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+// Record a CPU trace event for the rest of the enclosing scope
+#define TRACE_SCOPE_JOIN2(a, b) a##b
+#define TRACE_SCOPE_JOIN(a, b) TRACE_SCOPE_JOIN2(a, b)
+#define TRACE_SCOPE(name) trace::scope TRACE_SCOPE_JOIN(trace_scope_, __LINE__)(name)
+
+// A timeline of what every thread spends its time on, for chrome://tracing or ui.perfetto.dev
+/* Each thread writes to its own fixed size ring of events without locking; only
+* the first event of a thread takes a lock, to register its buffer. When a ring
+* is full the oldest events are overwritten, so tracing can be left on. While
+* disabled, a scope costs a single relaxed atomic load
+*/
+class trace
+{
+public:
+	// Events kept per thread before the oldest are overwritten
+	static constexpr size_t capacity = 1 << 16;
+
+	// Record an event from construction to destruction
+	// The name must outlive the trace; use string literals
+	class scope
+	{
+	public:
+		scope(const char* name);
+		~scope();
+
+		scope(const scope&) = delete;
+		scope& operator =(const scope&) = delete;
+
+	private:
+		const char* m_name;
+		std::int64_t m_begin;
+	};
+
+public:
+	static void enable(bool on) { g_enabled.store(on, std::memory_order_relaxed); }
+	static bool enabled() { return g_enabled.load(std::memory_order_relaxed); }
+
+	// Label the calling thread in the timeline
+	static void name_thread(const char* name);
+
+	// Write every event still held as Chrome trace event JSON
+	// Events being recorded while this runs may be missed or torn
+	static void write_json(std::ostream& out);
+
+private:
+	// Microseconds since the first use of the trace
+	static std::int64_t now();
+
+private:
+	static std::atomic<bool> g_enabled;
+};
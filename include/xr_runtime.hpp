@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+enum class xr_eye
+{
+	left,
+	right
+};
+
+enum class xr_hand
+{
+	left,
+	right
+};
+
+// Buttons are bits of xr_device::buttons
+enum xr_button : std::uint32_t
+{
+	xr_trigger = 1 << 0,
+	xr_menu = 1 << 1
+};
+
+// A tracked device as of the last call to xr_runtime::wait_frame
+struct xr_device
+{
+public:
+	// Invalid devices keep their last pose
+	bool valid = false;
+	// Device to tracking space
+	glm::mat4 pose{1.f};
+	// Buttons pressed or touched, as xr_button bits
+	std::uint32_t buttons = 0;
+};
+
+// The VR system the frame loop renders for
+/* Each frame waits for the runtime, reads the poses it latched, renders both
+* eyes side by side into one texture and submits it. The submitted frame is
+* reprojected from the head pose last latched. Rendering never talks to
+* the device directly, so a simulated headset can stand in for a real one
+*/
+class xr_runtime
+{
+public:
+	virtual ~xr_runtime() {}
+
+public:
+	// The recommended size of one eye's image
+	virtual glm::uvec2 render_size() const = 0;
+
+	// Block until the next frame should begin, and latch the device poses for it
+	virtual void wait_frame() = 0;
+	// Read the head pose again, as late as possible before the views are used
+	// It stays predicted for the same display time; runtimes that cannot do better keep the poses from wait_frame
+	virtual void latch() {}
+	// Hand the finished frame to the compositor
+	// The left eye is the left half of texture, and the right eye the right half
+	// The compositor may change any GL state
+	virtual void submit(GLuint texture) = 0;
+
+	virtual const xr_device& head() const = 0;
+	virtual const xr_device& hand(xr_hand h) const = 0;
+
+	// GL clip space projection for an eye
+	virtual glm::mat4 projection(xr_eye e, float near_plane, float far_plane) const = 0;
+	// The eye's position relative to the head
+	virtual glm::mat4 eye_to_head(xr_eye e) const = 0;
+
+	// Print what the compositor measured, if anything
+	virtual void report(std::ostream&) const {}
+};
@@ -172,15 +172,20 @@ audio::audio(device& d)
 	assert(m_freq != 0);
 
 	// Watch for refills
-	m_filler = std::thread([&]() {
-		while (m_should_run) {
-			for (auto& s : m_sources) {
-				s->dequeue_buffers();
-			}
+	m_filler = std::thread([&]() { this->fill(); });
+}
+
+void audio::fill() {
+	trace::name_thread("audio filler");
 
-			std::this_thread::yield();
+	while (m_should_run) {
+		for (auto& s : m_sources) {
+			TRACE_SCOPE("audio::source::dequeue_buffers");
+			s->dequeue_buffers();
 		}
-	});
+
+		std::this_thread::yield();
+	}
 }
 
 audio::~audio() {
@@ -197,15 +202,7 @@ audio::audio(audio&& other)
 	other.m_context = nullptr;
 	other.m_should_run = false;
 
-	m_filler = std::thread([&]() {
-		while (m_should_run) {
-			for (auto& s : m_sources) {
-				s->dequeue_buffers();
-			}
-
-			std::this_thread::yield();
-		}
-	});
+	m_filler = std::thread([&]() { this->fill(); });
 }
 
 audio& audio::operator =(audio&& other) {
@@ -222,15 +219,7 @@ audio& audio::operator =(audio&& other) {
 	other.m_context = nullptr;
 	other.m_should_run = false;
 
-	m_filler = std::thread([&]() {
-		while (m_should_run) {
-			for (auto& s : m_sources) {
-				s->dequeue_buffers();
-			}
-
-			std::this_thread::yield();
-		}
-	});
+	m_filler = std::thread([&]() { this->fill(); });
 
 	if (was_bound)
 		this->bind();
@@ -0,0 +1,126 @@
+#include <culling.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define CULLING_SSE
+#include <xmmintrin.h>
+#endif
+
+frustum::frustum(const glm::mat4& vp)
+{
+	// glm is column major; row i of the matrix is (vp[0][i], vp[1][i], vp[2][i], vp[3][i])
+	auto row = [&vp](int i) { return glm::vec4(vp[0][i], vp[1][i], vp[2][i], vp[3][i]); };
+
+	auto r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+	planes = {r3 + r0, r3 - r0, r3 + r1, r3 - r1, r3 + r2, r3 - r2};
+
+	for (auto& p : planes)
+		p = p / glm::length(glm::vec3(p));
+}
+
+projection_scale::projection_scale()
+: m_eye{0.f}, m_pixels{std::numeric_limits<float>::infinity()}, m_perspective{false}
+{
+}
+
+projection_scale::projection_scale(const glm::vec3& eye, float pixels)
+: m_eye{eye}, m_pixels{pixels}, m_perspective{true}
+{
+}
+
+projection_scale projection_scale::orthographic(float pixels)
+{
+	projection_scale s;
+	s.m_pixels = pixels;
+
+	return s;
+}
+
+float projection_scale::size(const glm::vec4& sphere) const
+{
+	auto diameter = sphere.w * 2.f * m_pixels;
+	if (!m_perspective)
+		return diameter;
+
+	// A viewer inside the sphere sees it fill the view
+	auto distance = glm::length(glm::vec3(sphere) - m_eye);
+	return diameter / std::max(distance, sphere.w);
+}
+
+void sphere_set::clear()
+{
+	m_x.clear();
+	m_y.clear();
+	m_z.clear();
+	m_radius.clear();
+
+	m_count = 0;
+}
+
+void sphere_set::push_back(const glm::vec3& center, float radius)
+{
+	// Grow four at a time; the padding is never reported as visible
+	if (m_count % 4 == 0)
+	{
+		m_x.resize(m_count + 4, 0.f);
+		m_y.resize(m_count + 4, 0.f);
+		m_z.resize(m_count + 4, 0.f);
+		m_radius.resize(m_count + 4, 0.f);
+	}
+
+	m_x[m_count] = center.x;
+	m_y[m_count] = center.y;
+	m_z[m_count] = center.z;
+	m_radius[m_count] = radius;
+
+	m_count += 1;
+}
+
+void sphere_set::cull(const std::vector<frustum>& any_of, std::vector<unsigned char>& visible) const
+{
+	visible.assign(m_count, any_of.empty() ? 1 : 0);
+
+	for (auto& f : any_of)
+	{
+		for (auto i = 0u; i < m_count; i += 4)
+		{
+#ifdef CULLING_SSE
+			auto x = _mm_loadu_ps(&m_x[i]);
+			auto y = _mm_loadu_ps(&m_y[i]);
+			auto z = _mm_loadu_ps(&m_z[i]);
+			auto neg_radius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&m_radius[i]));
+
+			// A sphere is outside if it is fully behind any one plane
+			auto inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+			for (auto& p : f.planes)
+			{
+				auto d = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(p.x)), _mm_mul_ps(y, _mm_set1_ps(p.y))),
+					_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(p.z)), _mm_set1_ps(p.w))
+				);
+
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(d, neg_radius));
+			}
+
+			auto mask = _mm_movemask_ps(inside);
+#else
+			int mask = 0;
+			for (auto j = 0u; j != 4; ++j)
+			{
+				bool in = true;
+				for (auto& p : f.planes)
+					in = in && (p.x * m_x[i + j] + p.y * m_y[i + j] + p.z * m_z[i + j] + p.w >= -m_radius[i + j]);
+
+				mask |= (in << j);
+			}
+#endif
+
+			auto lanes = std::min<size_t>(4, m_count - i);
+			for (auto j = 0u; j != lanes; ++j)
+				visible[i + j] |= (mask >> j) & 1;
+		}
+	}
+}
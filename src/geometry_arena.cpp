@@ -0,0 +1,121 @@
+#include <geometry_arena.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	// Instances per frame before the stream first grows
+	constexpr size_t initial_instances = 1024;
+}
+
+geometry_arena::geometry_arena(hs::context& c)
+: m_context{c}, m_dirty{false},
+  m_vertices{hs::array_buffer::empty<model::vertex>(c, GL_ARRAY_BUFFER, GL_STATIC_DRAW)},
+  m_indices{hs::array_buffer::empty<GLuint>(c, GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW)},
+  m_instances{std::make_unique<hs::stream_buffer>(hs::stream_buffer::empty<model::instance>(c, GL_ARRAY_BUFFER, initial_instances))},
+  m_stalls{0}
+{
+	using vertex = model::vertex;
+
+	for (auto views = 1u; views <= max_views; ++views)
+	{
+		hs::vertex_array state(c);
+		state.set_attribute(0, m_vertices, &vertex::position);
+		state.set_attribute(1, m_vertices, &vertex::normal);
+		state.set_attribute(model::color_attribute, m_vertices, &vertex::color);
+
+		state.set_elements(m_indices);
+		m_states.push_back(std::move(state));
+	}
+
+	point_instances();
+}
+
+geometry_arena::range geometry_arena::allocate(const std::vector<model::vertex>& vertices, const std::vector<GLuint>& indices)
+{
+	range r{static_cast<GLint>(m_vertex_data.size()), static_cast<GLuint>(m_index_data.size()), static_cast<GLsizei>(indices.size())};
+
+	m_vertex_data.insert(m_vertex_data.end(), vertices.begin(), vertices.end());
+	m_index_data.insert(m_index_data.end(), indices.begin(), indices.end());
+	m_dirty = true;
+
+	return r;
+}
+
+geometry_arena::range geometry_arena::allocate_indices(const range& base, const std::vector<GLuint>& indices)
+{
+	range r{base.base_vertex, static_cast<GLuint>(m_index_data.size()), static_cast<GLsizei>(indices.size())};
+
+	m_index_data.insert(m_index_data.end(), indices.begin(), indices.end());
+	m_dirty = true;
+
+	return r;
+}
+
+void geometry_arena::clear_instances()
+{
+	m_instance_data.clear();
+}
+
+GLuint geometry_arena::push_instances(const std::vector<model::instance>& insts)
+{
+	auto first = static_cast<GLuint>(m_instance_data.size());
+	m_instance_data.insert(m_instance_data.end(), insts.begin(), insts.end());
+
+	return first;
+}
+
+void geometry_arena::flush()
+{
+	if (m_dirty)
+	{
+		m_vertices.update(m_vertex_data.begin(), m_vertex_data.end());
+
+		// The element binding is vertex array state, so only touch our own
+		m_states.front().bind();
+		m_indices.update(m_index_data.begin(), m_index_data.end());
+		m_dirty = false;
+	}
+
+	if (m_instance_data.empty())
+		return;
+
+	// A new stream starts on a region nothing has read yet
+	if (m_instance_data.size() > m_instances->capacity())
+	{
+		auto capacity = std::max(m_instances->capacity() * 2, m_instance_data.size());
+
+		m_stalls += m_instances->stalls();
+		m_instances = std::make_unique<hs::stream_buffer>(hs::stream_buffer::empty<model::instance>(m_context, GL_ARRAY_BUFFER, capacity));
+	}
+	else
+	{
+		m_instances->next_region();
+	}
+
+	// Instance indices restart at zero in every region
+	m_instances->write(m_instance_data.begin(), m_instance_data.end());
+	point_instances();
+}
+
+void geometry_arena::point_instances()
+{
+	using instance = model::instance;
+	auto first = m_instances->region_offset() / sizeof(instance);
+
+	for (auto views = 1u; views <= max_views; ++views)
+	{
+		auto& state = m_states[views - 1];
+
+		// The transform matrix takes attributes 2 through 5
+		state.set_attribute({model::first_instance_attribute, false, GL_NONE, views}, *m_instances, &instance::transform, first);
+		state.set_attribute({model::last_instance_attribute, false, GL_NONE, views}, *m_instances, &instance::tint, first);
+	}
+}
+
+const hs::vertex_array& geometry_arena::get_state(size_t views) const
+{
+	assert(views && views <= max_views);
+	return m_states[views - 1];
+}
@@ -1,13 +1,70 @@
 #include <heatsink/context.hpp>
 
+#include <algorithm>
+#include <cassert>
+
 hs::context hs::context::empty_context{};
 
-bool hs::context::unique_name::operator ==(const unique_name& other) const
+namespace
+{
+	template<GLenum T>
+	void destroy_type(std::vector<GLuint>& names)
+	{
+		if (names.empty())
+			return;
+
+		hs::name_adaptor<T>::destroy(static_cast<GLsizei>(names.size()), names.data());
+		names.clear();
+	}
+}
+
+size_t hs::context::pending_deletions() const
 {
-	return ((type == other.type) && (name == other.name));
+	size_t count = 0;
+	for (auto& names : m_released)
+		count += names.size();
+	for (auto& r : m_retired)
+		for (auto& names : r.names)
+			count += names.size();
+
+	return count;
+}
+
+void hs::context::end_frame()
+{
+	// Frames finish in order, so stop at the first still running
+	while (!m_retired.empty())
+	{
+		auto& oldest = m_retired.front();
+
+		auto status = glClientWaitSync(oldest.fence, 0, 0);
+		if (status == GL_TIMEOUT_EXPIRED)
+			break;
+
+		assert(status != GL_WAIT_FAILED);
+
+		destroy_names(oldest.names);
+		glDeleteSync(oldest.fence);
+		m_retired.pop_front();
+	}
+
+	auto released = std::any_of(m_released.begin(), m_released.end(), [](const std::vector<GLuint>& names) {
+		return !names.empty();
+	});
+
+	if (!released)
+		return;
+
+	m_retired.push_back({glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), std::move(m_released)});
+	m_released = name_lists{};
 }
 
-size_t hs::context::unique_name_hash::operator ()(const unique_name& n) const
+void hs::context::destroy_names(name_lists& names)
 {
-	return (std::hash<GLenum>()(n.type) ^ std::hash<GLuint>()(n.name));
+	destroy_type<GL_BUFFER>(names[type_index(GL_BUFFER)]);
+	destroy_type<GL_FRAMEBUFFER>(names[type_index(GL_FRAMEBUFFER)]);
+	destroy_type<GL_PROGRAM>(names[type_index(GL_PROGRAM)]);
+	destroy_type<GL_SAMPLER>(names[type_index(GL_SAMPLER)]);
+	destroy_type<GL_TEXTURE>(names[type_index(GL_TEXTURE)]);
+	destroy_type<GL_VERTEX_ARRAY>(names[type_index(GL_VERTEX_ARRAY)]);
 }
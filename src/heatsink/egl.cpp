@@ -0,0 +1,157 @@
+#ifdef HEATSINK_EGL
+
+#include <heatsink/egl.hpp>
+
+#include <cassert>
+#include <cstring>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <GL/glew.h>
+
+namespace
+{
+	EGLDisplay g_display = EGL_NO_DISPLAY;
+	EGLConfig g_config = nullptr;
+	hs::settings g_settings;
+
+	// Whether config was chosen with pbuffer support
+	bool g_pbuffer = false;
+
+	bool has_extension(EGLDisplay d, const char* name)
+	{
+		auto* list = eglQueryString(d, EGL_EXTENSIONS);
+		return (list && std::strstr(list, name));
+	}
+
+	EGLDisplay open_display()
+	{
+		// Prefer a display that needs no window system at all
+		auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+		if (get_platform_display && has_extension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless"))
+		{
+			auto d = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+			if (d != EGL_NO_DISPLAY)
+				return d;
+		}
+
+		return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLConfig choose_config(EGLint surface_type)
+	{
+		const EGLint attributes[] =
+		{
+			EGL_SURFACE_TYPE, surface_type,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_RED_SIZE, 8,
+			EGL_GREEN_SIZE, 8,
+			EGL_BLUE_SIZE, 8,
+			EGL_ALPHA_SIZE, 8,
+			EGL_DEPTH_SIZE, 24,
+			EGL_SAMPLES, static_cast<EGLint>(g_settings.samples > 1 ? g_settings.samples : 0),
+			EGL_NONE
+		};
+
+		EGLConfig config = nullptr;
+		EGLint count = 0;
+		if (!eglChooseConfig(g_display, attributes, &config, 1, &count) || count == 0)
+			return nullptr;
+
+		return config;
+	}
+}
+
+void hs::backend::egl::init(const settings& s)
+{
+	g_settings = s;
+
+	g_display = open_display();
+	assert(g_display != EGL_NO_DISPLAY);
+
+	auto initialized = eglInitialize(g_display, nullptr, nullptr);
+	assert(initialized);
+
+	auto bound = eglBindAPI(EGL_OPENGL_API);
+	assert(bound);
+
+	g_config = choose_config(EGL_PBUFFER_BIT);
+	g_pbuffer = (g_config != nullptr);
+
+	if (!g_config)
+	{
+		// Without pbuffers, drawing is only possible to framebuffer objects
+		assert(has_extension(g_display, "EGL_KHR_surfaceless_context"));
+		g_config = choose_config(0);
+	}
+
+	assert(g_config);
+}
+
+hs::backend::egl::egl_window::egl_window(const std::string&, glm::uvec2 size, size_t frame_limit)
+	: window(size), m_context{nullptr}, m_surface{nullptr}, m_frame_limit{frame_limit}, m_frames{0}
+{
+	assert(g_display != EGL_NO_DISPLAY && "egl::init must be called first");
+
+	const EGLint context_attributes[] =
+	{
+		EGL_CONTEXT_MAJOR_VERSION, static_cast<EGLint>(g_settings.version_major),
+		EGL_CONTEXT_MINOR_VERSION, static_cast<EGLint>(g_settings.version_minor),
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE, g_settings.forward_only ? EGL_TRUE : EGL_FALSE,
+		EGL_NONE
+	};
+
+	m_context = eglCreateContext(g_display, g_config, EGL_NO_CONTEXT, context_attributes);
+	assert(m_context != EGL_NO_CONTEXT);
+
+	if (g_pbuffer)
+	{
+		const EGLint surface_attributes[] =
+		{
+			EGL_WIDTH, static_cast<EGLint>(size.x),
+			EGL_HEIGHT, static_cast<EGLint>(size.y),
+			EGL_NONE
+		};
+
+		m_surface = eglCreatePbufferSurface(g_display, g_config, surface_attributes);
+		assert(m_surface != EGL_NO_SURFACE);
+	}
+
+	make_active();
+	load_functions();
+}
+
+hs::backend::egl::egl_window::~egl_window()
+{
+	eglMakeCurrent(g_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+	if (m_surface)
+		eglDestroySurface(g_display, m_surface);
+	eglDestroyContext(g_display, m_context);
+}
+
+void hs::backend::egl::egl_window::make_active() const
+{
+	auto surface = m_surface ? static_cast<EGLSurface>(m_surface) : EGL_NO_SURFACE;
+
+	auto current = eglMakeCurrent(g_display, surface, surface, static_cast<EGLContext>(m_context));
+	assert(current);
+
+	state_cache::make_current(get_context().get_state());
+}
+
+bool hs::backend::egl::egl_window::refresh() const
+{
+	// Nothing is presented, so make sure the frame's work is submitted
+	if (m_surface)
+		eglSwapBuffers(g_display, m_surface);
+	else
+		glFlush();
+
+	m_frames += 1;
+	return (m_frame_limit == 0 || m_frames < m_frame_limit);
+}
+
+#endif
@@ -15,17 +15,7 @@ void hs::backend::init(const settings& s)
 	if (s.forward_only)
 		glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 
-	// Create a dummy window to allow glew to be initialized
-	auto* dummy = glfwCreateWindow(100, 100, "heatsink", nullptr, nullptr);
-	assert(dummy);
-
-	glfwMakeContextCurrent(dummy);
-	glewExperimental = true;
-
-	auto glew_result = glewInit();
-	assert(glew_result == GLEW_OK);
-
-	glfwDestroyWindow(dummy);
+	// GL functions are loaded by the first window, which needs no dummy
 }
 
 hs::backend::glfw_window::glfw_window(const std::string& name, glm::uvec2 size)
@@ -39,6 +29,7 @@ hs::backend::glfw_window::glfw_window(const std::string& name, glm::uvec2 size)
 	m_fbsize = glm::uvec2(static_cast<size_t>(w), static_cast<size_t>(h));
 
 	make_active();
+	load_functions();
 }
 
 hs::backend::glfw_window::~glfw_window()
@@ -49,6 +40,7 @@ hs::backend::glfw_window::~glfw_window()
 void hs::backend::glfw_window::make_active() const
 {
 	glfwMakeContextCurrent(m_handle);
+	state_cache::make_current(get_context().get_state());
 }
 
 bool hs::backend::glfw_window::refresh() const
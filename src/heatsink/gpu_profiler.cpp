@@ -0,0 +1,232 @@
+#include <heatsink/gpu_profiler.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+#include <numeric>
+
+void hs::gpu_profiler::rolling::add(double v)
+{
+	if (m_values.size() < window)
+	{
+		m_values.push_back(v);
+		m_next = m_values.size() % window;
+		return;
+	}
+
+	m_values[m_next] = v;
+	m_next = (m_next + 1) % window;
+}
+
+double hs::gpu_profiler::rolling::last() const
+{
+	if (m_values.empty())
+		return 0.0;
+
+	return m_values[(m_next + m_values.size() - 1) % m_values.size()];
+}
+
+double hs::gpu_profiler::rolling::mean() const
+{
+	if (m_values.empty())
+		return 0.0;
+
+	return std::accumulate(m_values.begin(), m_values.end(), 0.0) / m_values.size();
+}
+
+double hs::gpu_profiler::rolling::min() const
+{
+	return m_values.empty() ? 0.0 : *std::min_element(m_values.begin(), m_values.end());
+}
+
+double hs::gpu_profiler::rolling::max() const
+{
+	return m_values.empty() ? 0.0 : *std::max_element(m_values.begin(), m_values.end());
+}
+
+hs::gpu_profiler::gpu_profiler(counter_mask enabled, size_t latency)
+	: m_enabled{enabled}, m_frames(latency), m_current{0}, m_counting{false}, m_dropped{0}
+{
+	assert(latency >= 2);
+}
+
+hs::gpu_profiler::~gpu_profiler()
+{
+	for (auto& f : m_frames)
+		if (!f.queries.empty())
+			glDeleteQueries(f.queries.size(), f.queries.data());
+}
+
+void hs::gpu_profiler::begin_frame()
+{
+	assert(m_open.empty());
+
+	m_current = (m_current + 1) % m_frames.size();
+
+	auto& f = m_frames[m_current];
+	collect(f);
+
+	f.records.clear();
+	f.used = 0;
+}
+
+void hs::gpu_profiler::begin(const std::string& name, counter_mask counters)
+{
+	counters &= m_enabled;
+
+	auto index = m_indices.find(name);
+	if (index == m_indices.end())
+	{
+		index = m_indices.emplace(name, m_sections.size()).first;
+		m_sections.push_back({name});
+	}
+
+	record r{index->second, counters, 0, 0, 0, 0, std::chrono::steady_clock::now(), 0.0};
+
+	if (counters & elapsed)
+	{
+		r.begin = next_query();
+		r.end = next_query();
+		glQueryCounter(r.begin, GL_TIMESTAMP);
+	}
+
+	// Only one query of each of these targets can be active at once
+	if (counters & (primitives | samples))
+	{
+		assert(!m_counting);
+		m_counting = true;
+	}
+
+	if (counters & primitives)
+	{
+		r.primitives = next_query();
+		glBeginQuery(GL_PRIMITIVES_GENERATED, r.primitives);
+	}
+
+	if (counters & samples)
+	{
+		r.samples = next_query();
+		glBeginQuery(GL_SAMPLES_PASSED, r.samples);
+	}
+
+	auto& f = m_frames[m_current];
+	m_open.push_back(f.records.size());
+	f.records.push_back(r);
+}
+
+void hs::gpu_profiler::end()
+{
+	assert(!m_open.empty());
+
+	auto& r = m_frames[m_current].records[m_open.back()];
+	m_open.pop_back();
+
+	if (r.counters & elapsed)
+		glQueryCounter(r.end, GL_TIMESTAMP);
+	if (r.counters & primitives)
+		glEndQuery(GL_PRIMITIVES_GENERATED);
+	if (r.counters & samples)
+		glEndQuery(GL_SAMPLES_PASSED);
+
+	if (r.counters & (primitives | samples))
+		m_counting = false;
+
+	std::chrono::duration<double, std::milli> cpu = std::chrono::steady_clock::now() - r.cpu_begin;
+	r.cpu = cpu.count();
+}
+
+void hs::gpu_profiler::report(std::ostream& out) const
+{
+	auto flags = out.flags();
+	out << std::fixed << std::setprecision(3);
+
+	for (auto& s : m_sections)
+	{
+		out << s.name << ": GPU " << s.gpu.mean() << "ms (" << s.gpu.min() << " - " << s.gpu.max() << "), CPU " << s.cpu.mean() << "ms";
+		if (s.primitives.count())
+			out << ", " << static_cast<size_t>(s.primitives.mean()) << " primitives";
+		if (s.samples.count())
+			out << ", " << static_cast<size_t>(s.samples.mean()) << " samples";
+
+		out << std::endl;
+	}
+
+	// Dropped sections are missing from the means, which then lean towards the faster frames
+	out << "Sections dropped waiting on the GPU: " << m_dropped << std::endl;
+
+	out.flags(flags);
+}
+
+void hs::gpu_profiler::write_csv(std::ostream& out) const
+{
+	out << "section,gpu_ms,gpu_min_ms,gpu_max_ms,cpu_ms,cpu_min_ms,cpu_max_ms,primitives,samples" << std::endl;
+
+	for (auto& s : m_sections)
+	{
+		out << s.name << ',' << s.gpu.mean() << ',' << s.gpu.min() << ',' << s.gpu.max() << ','
+		    << s.cpu.mean() << ',' << s.cpu.min() << ',' << s.cpu.max() << ','
+		    << s.primitives.mean() << ',' << s.samples.mean() << std::endl;
+	}
+}
+
+GLuint hs::gpu_profiler::next_query()
+{
+	auto& f = m_frames[m_current];
+	if (f.used == f.queries.size())
+	{
+		f.queries.push_back(0);
+		glGenQueries(1, &f.queries.back());
+	}
+
+	return f.queries[f.used++];
+}
+
+void hs::gpu_profiler::collect(frame& f)
+{
+	auto ready = [](GLuint q) {
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(q, GL_QUERY_RESULT_AVAILABLE, &available);
+
+		return (available == GL_TRUE);
+	};
+
+	for (auto& r : f.records)
+	{
+		// Every query of a record must be ready, or the whole record is dropped
+		bool complete = true;
+		for (auto q : {r.end, r.primitives, r.samples})
+			complete = complete && (!q || ready(q));
+
+		if (!complete)
+		{
+			m_dropped += 1;
+			continue;
+		}
+
+		auto& s = m_sections[r.section];
+		s.cpu.add(r.cpu);
+
+		if (r.counters & elapsed)
+		{
+			GLuint64 begin, end;
+			glGetQueryObjectui64v(r.begin, GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(r.end, GL_QUERY_RESULT, &end);
+
+			s.gpu.add((end - begin) / 1.0e6);
+		}
+
+		if (r.counters & primitives)
+		{
+			GLuint64 count;
+			glGetQueryObjectui64v(r.primitives, GL_QUERY_RESULT, &count);
+			s.primitives.add(static_cast<double>(count));
+		}
+
+		if (r.counters & samples)
+		{
+			GLuint64 count;
+			glGetQueryObjectui64v(r.samples, GL_QUERY_RESULT, &count);
+			s.samples.add(static_cast<double>(count));
+		}
+	}
+}
@@ -0,0 +1,69 @@
+#include <heatsink/handle_pool.hpp>
+
+#include <cassert>
+
+hs::handle_pool::handle_pool()
+	: m_live{0}
+{
+}
+
+hs::handle_pool::handle hs::handle_pool::acquire(GLuint name)
+{
+	m_live += 1;
+
+	if (m_free.empty())
+	{
+		m_slots.push_back({name, 1, 0});
+		return {static_cast<std::uint32_t>(m_slots.size() - 1), 0};
+	}
+
+	auto index = m_free.back();
+	m_free.pop_back();
+
+	auto& s = m_slots[index];
+	s.name = name;
+	s.references = 1;
+
+	return {index, s.generation};
+}
+
+void hs::handle_pool::retain(handle h)
+{
+	get(h).references += 1;
+}
+
+bool hs::handle_pool::release(handle h)
+{
+	auto& s = get(h);
+
+	s.references -= 1;
+	if (s.references)
+		return false;
+
+	// Any handle still holding the old generation is now stale
+	s.generation += 1;
+	m_free.push_back(h.index);
+	m_live -= 1;
+
+	return true;
+}
+
+GLuint hs::handle_pool::name(handle h) const
+{
+	return get(h).name;
+}
+
+hs::handle_pool::slot& hs::handle_pool::get(handle h)
+{
+	return const_cast<slot&>(static_cast<const handle_pool&>(*this).get(h));
+}
+
+const hs::handle_pool::slot& hs::handle_pool::get(handle h) const
+{
+	assert(h.index < m_slots.size());
+
+	auto& s = m_slots[h.index];
+	assert(s.generation == h.generation && s.references && "handle_pool: stale handle");
+
+	return s;
+}
@@ -0,0 +1,31 @@
+#include <heatsink/init.hpp>
+
+#include <cassert>
+
+#include <GL/glew.h>
+
+void hs::backend::load_functions()
+{
+	static bool loaded = false;
+	if (loaded)
+		return;
+
+	glewExperimental = true;
+	auto result = glewInit();
+
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	// A GLEW built for GLX loads every GL function before failing to find a display,
+	// so an EGL context is still usable
+	if (result == GLEW_ERROR_NO_GLX_DISPLAY)
+		result = GLEW_OK;
+#endif
+
+	assert(result == GLEW_OK);
+	loaded = true;
+
+#ifdef GL_KHR_parallel_shader_compile
+	// Let the driver compile on its own threads; programs only wait when first used
+	if (GLEW_KHR_parallel_shader_compile)
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+#endif
+}
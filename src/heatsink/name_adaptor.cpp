@@ -2,137 +2,168 @@
 
 #include <cassert>
 
+#include <heatsink/state_cache.hpp>
+
+namespace
+{
+	// Let the current state cache know names are gone
+	void forget(GLenum type, GLsizei count, const GLuint* names)
+	{
+		if (auto* cache = hs::state_cache::current())
+			for (auto i = 0; i != count; ++i)
+				cache->forget(type, names[i]);
+	}
+}
+
 namespace hs
 {
 	template<>
-	GLuint name_adaptor<GL_BUFFER>::create()
+	void name_adaptor<GL_BUFFER>::create(GLsizei count, GLuint* names)
 	{
-		GLuint name;
-		glGenBuffers(1, &name);
-		assert(name);
-
-		return name;
+		glGenBuffers(count, names);
+		assert(names[0]);
 	}
 
 	template<>
-	void name_adaptor<GL_BUFFER>::destroy(GLuint name)
+	void name_adaptor<GL_BUFFER>::destroy(GLsizei count, const GLuint* names)
 	{
-		glDeleteBuffers(1, &name);
+		forget(GL_BUFFER, count, names);
+		glDeleteBuffers(count, names);
 	}
 
 	template<>
 	void name_adaptor<GL_BUFFER>::bind(GLuint name, GLenum mode)
 	{
+		auto* cache = state_cache::current();
+		if (cache && !cache->bind_buffer(mode, name))
+			return;
+
 		glBindBuffer(mode, name);
 	}
 
 	template<>
-	GLuint name_adaptor<GL_FRAMEBUFFER>::create()
+	void name_adaptor<GL_FRAMEBUFFER>::create(GLsizei count, GLuint* names)
 	{
-		GLuint name;
-		glGenFramebuffers(1, &name);
-		assert(name);
-
-		return name;
+		glGenFramebuffers(count, names);
+		assert(names[0]);
 	}
 
 	template<>
-	void name_adaptor<GL_FRAMEBUFFER>::destroy(GLuint name)
+	void name_adaptor<GL_FRAMEBUFFER>::destroy(GLsizei count, const GLuint* names)
 	{
-		glDeleteFramebuffers(1, &name);
+		forget(GL_FRAMEBUFFER, count, names);
+		glDeleteFramebuffers(count, names);
 	}
 
 	template<>
 	void name_adaptor<GL_FRAMEBUFFER>::bind(GLuint name, GLenum mode)
 	{
+		auto* cache = state_cache::current();
+		if (cache && !cache->bind_framebuffer(mode, name))
+			return;
+
 		glBindFramebuffer(mode, name);
 	}
 
 	template<>
-	GLuint name_adaptor<GL_SAMPLER>::create()
+	void name_adaptor<GL_SAMPLER>::create(GLsizei count, GLuint* names)
 	{
-		GLuint name;
-		glGenSamplers(1, &name);
-		assert(name);
-
-		return name;
+		glGenSamplers(count, names);
+		assert(names[0]);
 	}
 
 	template<>
-	void name_adaptor<GL_SAMPLER>::destroy(GLuint name)
+	void name_adaptor<GL_SAMPLER>::destroy(GLsizei count, const GLuint* names)
 	{
-		glDeleteSamplers(1, &name);
+		forget(GL_SAMPLER, count, names);
+		glDeleteSamplers(count, names);
 	}
 
 	template<>
 	void name_adaptor<GL_SAMPLER>::bind(GLuint name, size_t unit)
 	{
+		auto* cache = state_cache::current();
+		if (cache && !cache->bind_sampler(unit, name))
+			return;
+
 		glBindSampler(unit, name);
 	}
 
 	template<>
-	GLuint name_adaptor<GL_PROGRAM>::create()
+	void name_adaptor<GL_PROGRAM>::create(GLsizei count, GLuint* names)
 	{
-		GLuint name{glCreateProgram()};
-		assert(name);
-
-		return name;
+		// Programs have no batched form
+		for (auto i = 0; i != count; ++i)
+		{
+			names[i] = glCreateProgram();
+			assert(names[i]);
+		}
 	}
 
 	template<>
-	void name_adaptor<GL_PROGRAM>::destroy(GLuint name)
+	void name_adaptor<GL_PROGRAM>::destroy(GLsizei count, const GLuint* names)
 	{
-		glDeleteProgram(name);
+		forget(GL_PROGRAM, count, names);
+		for (auto i = 0; i != count; ++i)
+			glDeleteProgram(names[i]);
 	}
 
 	template<>
 	void name_adaptor<GL_PROGRAM>::bind(GLuint name)
 	{
+		auto* cache = state_cache::current();
+		if (cache && !cache->use_program(name))
+			return;
+
 		glUseProgram(name);
 	}
 
 	template<>
-	GLuint name_adaptor<GL_TEXTURE>::create()
+	void name_adaptor<GL_TEXTURE>::create(GLsizei count, GLuint* names)
 	{
-		GLuint name;
-		glGenTextures(1, &name);
-		assert(name);
-
-		return name;
+		glGenTextures(count, names);
+		assert(names[0]);
 	}
 
 	template<>
-	void name_adaptor<GL_TEXTURE>::destroy(GLuint name)
+	void name_adaptor<GL_TEXTURE>::destroy(GLsizei count, const GLuint* names)
 	{
-		glDeleteTextures(1, &name);
+		forget(GL_TEXTURE, count, names);
+		glDeleteTextures(count, names);
 	}
 
 	template<>
 	void name_adaptor<GL_TEXTURE>::bind(GLuint name, GLenum mode, size_t unit)
 	{
-		glActiveTexture(GL_TEXTURE0 + unit);
-		glBindTexture(mode, name);
+		// The unit is always made active, callers may edit the texture after binding
+		auto* cache = state_cache::current();
+		if (!cache || cache->active_texture(unit))
+			glActiveTexture(GL_TEXTURE0 + unit);
+		if (!cache || cache->bind_texture(unit, mode, name))
+			glBindTexture(mode, name);
 	}
 
 	template<>
-	GLuint name_adaptor<GL_VERTEX_ARRAY>::create()
+	void name_adaptor<GL_VERTEX_ARRAY>::create(GLsizei count, GLuint* names)
 	{
-		GLuint name;
-		glGenVertexArrays(1, &name);
-		assert(name);
-
-		return name;
+		glGenVertexArrays(count, names);
+		assert(names[0]);
 	}
 
 	template<>
-	void name_adaptor<GL_VERTEX_ARRAY>::destroy(GLuint name)
+	void name_adaptor<GL_VERTEX_ARRAY>::destroy(GLsizei count, const GLuint* names)
 	{
-		glDeleteVertexArrays(1, &name);
+		forget(GL_VERTEX_ARRAY, count, names);
+		glDeleteVertexArrays(count, names);
 	}
 
 	template<>
 	void name_adaptor<GL_VERTEX_ARRAY>::bind(GLuint name)
 	{
+		auto* cache = state_cache::current();
+		if (cache && !cache->bind_vertex_array(name))
+			return;
+
 		glBindVertexArray(name);
 	}
 }
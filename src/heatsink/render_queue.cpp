@@ -0,0 +1,113 @@
+#include <heatsink/render_queue.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+hs::render_queue::render_queue(context& c)
+	: m_commands{std::make_unique<stream_buffer>(stream_buffer::empty<indirect_command>(c, GL_DRAW_INDIRECT_BUFFER, 256))},
+	  m_context{c}, m_stalls{0}, m_prepared{true}
+{
+}
+
+void hs::render_queue::push(const packet& p)
+{
+	assert(p.state->indexing() != GL_NONE);
+
+	m_packets.emplace_back(make_key(p), p);
+	m_prepared = false;
+}
+
+void hs::render_queue::submit(size_t pass)
+{
+	if (!m_prepared)
+		prepare();
+
+	auto by_key = [](const std::pair<std::uint64_t, packet>& a, std::uint64_t key) {
+		return (a.first < key);
+	};
+
+	auto first = std::lower_bound(m_packets.begin(), m_packets.end(), std::uint64_t(pass) << 56, by_key);
+	auto last = std::lower_bound(first, m_packets.end(), std::uint64_t(pass + 1) << 56, by_key);
+
+	if (first == last)
+		return;
+
+	m_commands->bind();
+
+	shader* program = nullptr;
+	while (first != last)
+	{
+		auto& p = first->second;
+
+		if (p.program != program)
+		{
+			p.program->bind();
+			program = p.program;
+		}
+
+		auto batch_end = std::find_if(first, last, [&p](const std::pair<std::uint64_t, packet>& other) {
+			auto& o = other.second;
+			return (o.program != p.program || o.state != p.state || o.primitive != p.primitive);
+		});
+
+		auto offset = m_commands->region_offset() + static_cast<size_t>(first - m_packets.begin()) * sizeof(indirect_command);
+		auto count = static_cast<GLsizei>(batch_end - first);
+
+		p.state->bind();
+		glMultiDrawElementsIndirect(p.primitive, p.state->indexing(), (void*)offset, count, 0);
+
+		first = batch_end;
+	}
+}
+
+void hs::render_queue::clear()
+{
+	m_packets.clear();
+	m_prepared = true;
+}
+
+std::uint64_t hs::render_queue::make_key(const packet& p)
+{
+	assert(p.pass < 0xFF);
+
+	return (std::uint64_t(p.pass) << 56)
+		| (std::uint64_t(p.program->name() & 0xFFFFFF) << 32)
+		| std::uint64_t(p.state->name());
+}
+
+void hs::render_queue::prepare()
+{
+	auto by_key = [](const std::pair<std::uint64_t, packet>& a, const std::pair<std::uint64_t, packet>& b) {
+		return (a.first < b.first);
+	};
+
+	std::stable_sort(m_packets.begin(), m_packets.end(), by_key);
+
+	m_command_data.clear();
+	m_command_data.reserve(m_packets.size());
+
+	for (auto& entry : m_packets)
+	{
+		auto& p = entry.second;
+		m_command_data.push_back({
+			static_cast<GLuint>(p.count), static_cast<GLuint>(p.instances),
+			p.first, p.base_vertex, p.base_instance
+		});
+	}
+
+	if (m_command_data.size() > m_commands->capacity())
+	{
+		auto capacity = std::max(m_commands->capacity() * 2, m_command_data.size());
+
+		m_stalls += m_commands->stalls();
+		m_commands = std::make_unique<stream_buffer>(stream_buffer::empty<indirect_command>(m_context, GL_DRAW_INDIRECT_BUFFER, capacity));
+	}
+	else
+	{
+		m_commands->next_region();
+	}
+
+	m_commands->write(m_command_data.begin(), m_command_data.end());
+
+	m_prepared = true;
+}
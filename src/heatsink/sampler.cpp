@@ -0,0 +1,30 @@
+#include <heatsink/sampler.hpp>
+
+void hs::sampler::set_filter(GLenum min, GLenum mag)
+{
+	glSamplerParameteri(this->m_name, GL_TEXTURE_MIN_FILTER, min);
+	glSamplerParameteri(this->m_name, GL_TEXTURE_MAG_FILTER, mag);
+}
+
+void hs::sampler::set_wrap(GLenum s, GLenum t)
+{
+	glSamplerParameteri(this->m_name, GL_TEXTURE_WRAP_S, s);
+	glSamplerParameteri(this->m_name, GL_TEXTURE_WRAP_T, t);
+}
+
+void hs::sampler::set_border(const glm::vec4& color)
+{
+	glSamplerParameterfv(this->m_name, GL_TEXTURE_BORDER_COLOR, &color[0]);
+}
+
+void hs::sampler::set_compare(GLenum func)
+{
+	if (func == GL_NONE)
+	{
+		glSamplerParameteri(this->m_name, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+		return;
+	}
+
+	glSamplerParameteri(this->m_name, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glSamplerParameteri(this->m_name, GL_TEXTURE_COMPARE_FUNC, func);
+}
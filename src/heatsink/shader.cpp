@@ -1,6 +1,112 @@
 #include <heatsink/shader.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
 #include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <unordered_set>
+
+namespace
+{
+	std::string g_cache_directory;
+	hs::shader::cache_statistics g_statistics{0, 0};
+
+	// Marks a file as a cached binary; change it if the layout changes
+	const std::uint32_t binary_magic = 0x42505348;
+
+	// FNV-1a; only needs to tell sources apart, not resist attacks
+	std::uint64_t hash(std::uint64_t h, const std::string& s)
+	{
+		for (auto c : s)
+		{
+			h ^= static_cast<unsigned char>(c);
+			h *= 1099511628211ull;
+		}
+
+		return h;
+	}
+
+	// A binary only loads on the driver that made it
+	const std::string& driver_string()
+	{
+		static std::string driver;
+		if (!driver.empty())
+			return driver;
+
+		for (auto e : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+		{
+			if (auto* s = glGetString(e))
+				driver += reinterpret_cast<const char*>(s);
+			driver += '\n';
+		}
+
+		return driver;
+	}
+
+	bool binaries_supported()
+	{
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+		return (formats > 0);
+	}
+
+	// Read a file, replacing each #include with the file it names
+	// A file is only included once per stage, so shared files need no guards
+	std::string load_source(const std::string& path, std::unordered_set<std::string>& included)
+	{
+		std::ifstream stream(path.c_str());
+		assert(stream.is_open());
+
+		auto directory = path.substr(0, path.find_last_of("/\\") + 1);
+
+		std::string source;
+		std::string line;
+		for (size_t number = 1; std::getline(stream, line); ++number)
+		{
+			auto start = line.find_first_not_of(" \t");
+			if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+			{
+				source += line + '\n';
+				continue;
+			}
+
+			auto open = line.find('"', start);
+			auto close = line.find('"', open + 1);
+			assert(open != std::string::npos && close != std::string::npos);
+
+			auto file = directory + line.substr(open + 1, close - open - 1);
+			if (included.insert(file).second)
+				source += "#line 1\n" + load_source(file, included);
+
+			// Keep compiler errors pointing at the right line of this file
+			source += "#line " + std::to_string(number + 1) + '\n';
+		}
+
+		return source;
+	}
+
+	// Place defines after the #version line, which must stay first
+	std::string specialize(const std::string& source, const std::vector<std::string>& defines)
+	{
+		if (defines.empty())
+			return source;
+
+		size_t offset = 0;
+		if (source.compare(0, 8, "#version") == 0)
+			offset = source.find('\n') + 1;
+
+		std::string block;
+		for (auto& d : defines)
+			block += "#define " + d + '\n';
+
+		// The first line after the block is still the second line of the file
+		block += "#line " + std::to_string(offset ? 2 : 1) + '\n';
+		return source.substr(0, offset) + block + source.substr(offset);
+	}
+}
 
 hs::shader::stage::name hs::shader::stage::deduce_name(const std::string& path)
 {
@@ -45,14 +151,8 @@ GLenum hs::shader::stage::to_kind(name n)
 hs::shader::stage::stage(const std::string& path, name n)
 	: kind{to_kind(n)}
 {
-	std::ifstream stream(path.c_str());
-	assert(stream.is_open());
-
-	std::istreambuf_iterator<char> start{stream};
-	std::istreambuf_iterator<char> end{};
-
-	source = std::string(start, end);
-	stream.close();
+	std::unordered_set<std::string> included{path};
+	source = load_source(path, included);
 }
 
 std::string hs::shader::get_shader_error(GLuint id)
@@ -79,68 +179,197 @@ std::string hs::shader::get_program_error(GLuint id)
 	return std::string(message.begin(), message.end());
 }
 
-hs::shader::shader(context& c, const std::vector<stage>& stages)
-	: context::identifier<GL_PROGRAM>(c)
+void hs::shader::set_binary_cache(const std::string& directory)
+{
+	g_cache_directory = directory;
+}
+
+hs::shader::cache_statistics hs::shader::get_cache_statistics()
 {
-	std::vector<GLuint> shaders;
+	return g_statistics;
+}
+
+hs::shader::shader(context& c, const std::vector<stage>& stages, const std::vector<std::string>& defines)
+	: context::identifier<GL_PROGRAM>(c), m_linked{false}, m_defines{defines}
+{
+	std::vector<std::string> sources;
 	for (auto& s : stages)
+		sources.push_back(specialize(s.source, defines));
+
+	if (!g_cache_directory.empty() && binaries_supported())
+	{
+		auto key = hash(14695981039346656037ull, driver_string());
+		for (auto i = 0u; i != stages.size(); ++i)
+			key = hash(hash(key, std::to_string(stages[i].kind)), sources[i]);
+
+		std::ostringstream file;
+		file << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+		m_cache_path = g_cache_directory + "/" + file.str();
+
+		if (load_binary())
+		{
+			m_linked = true;
+			g_statistics.loaded += 1;
+
+			return;
+		}
+
+		glProgramParameteri(this->m_name, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	// No status is read here; that would wait for each program in turn
+	for (auto i = 0u; i != stages.size(); ++i)
 	{
-		auto shader = glCreateShader(s.kind);
+		auto shader = glCreateShader(stages[i].kind);
 		assert(shader);
 
-		const auto* raw = s.source.c_str();
+		const auto* raw = sources[i].c_str();
 		glShaderSource(shader, 1, &raw, nullptr);
 		glCompileShader(shader);
 
-		GLint result;
-		glGetShaderiv(shader, GL_COMPILE_STATUS, &result);
-		assert(result == GL_TRUE);
-
-		shaders.push_back(shader);
+		m_stages.push_back(shader);
 	}
 
-	for (const auto& s : shaders)
+	for (const auto& s : m_stages)
 		glAttachShader(this->m_name, s);
 
 	glLinkProgram(this->m_name);
+	g_statistics.compiled += 1;
+}
+
+hs::shader::shader(const shader& other)
+	: context::identifier<GL_PROGRAM>(other), m_uniforms{other.m_uniforms},
+	  m_linked{true}, m_cache_path{other.m_cache_path}, m_defines{other.m_defines}
+{
+	// The stages belong to other, so the link is resolved there before sharing the program
+	other.finish_link();
+}
+
+hs::shader::~shader()
+{
+	// Never used, so linking was never finished; the stages go once the program does
+	for (auto& s : m_stages)
+		glDeleteShader(s);
+}
+
+void hs::shader::bind() const
+{
+	finish_link();
+	context::identifier<GL_PROGRAM>::bind();
+}
 
+void hs::shader::finish_link() const
+{
+	if (m_linked)
+		return;
+
+	// Blocks until the driver is done, if it is still compiling in the background
 	GLint result;
 	glGetProgramiv(this->m_name, GL_LINK_STATUS, &result);
+
+	for (auto& s : m_stages)
+	{
+		GLint compiled;
+		glGetShaderiv(s, GL_COMPILE_STATUS, &compiled);
+		assert(compiled == GL_TRUE);
+	}
+
 	assert(result == GL_TRUE);
 
 	/* The shaders could be stored and shared with other programs in a
 	* more complicated build system, but just delete them once they are
 	* no longer needed, for now.
 	*/
-	for (auto& s : shaders)
+	for (auto& s : m_stages)
 	{
 		glDetachShader(this->m_name, s);
 		glDeleteShader(s);
 	}
+
+	m_stages.clear();
+	m_linked = true;
+
+	if (!m_cache_path.empty())
+		save_binary();
+}
+
+bool hs::shader::is_defined(const std::string& name) const
+{
+	return std::any_of(m_defines.begin(), m_defines.end(), [&name](const std::string& d) {
+		return (d.compare(0, name.size(), name) == 0 && (d.size() == name.size() || d[name.size()] == ' '));
+	});
+}
+
+bool hs::shader::load_binary()
+{
+	std::ifstream in(m_cache_path, std::ios::binary);
+	if (!in.is_open())
+		return false;
+
+	std::uint32_t magic = 0;
+	GLenum format = 0;
+	in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	in.read(reinterpret_cast<char*>(&format), sizeof(format));
+
+	if (!in || magic != binary_magic)
+		return false;
+
+	std::vector<char> binary{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+	glProgramBinary(this->m_name, format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+	// A driver update can reject an old binary; the program is then compiled as usual
+	GLint result;
+	glGetProgramiv(this->m_name, GL_LINK_STATUS, &result);
+
+	return (result == GL_TRUE);
+}
+
+void hs::shader::save_binary() const
+{
+	GLint length = 0;
+	glGetProgramiv(this->m_name, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> binary(length);
+	GLenum format;
+	glGetProgramBinary(this->m_name, length, nullptr, &format, binary.data());
+
+	// The cache is only an optimization; failing to write it is not an error
+	std::error_code error;
+	std::filesystem::create_directories(g_cache_directory, error);
+
+	std::ofstream out(m_cache_path, std::ios::binary);
+	if (!out.is_open())
+		return;
+
+	out.write(reinterpret_cast<const char*>(&binary_magic), sizeof(binary_magic));
+	out.write(reinterpret_cast<const char*>(&format), sizeof(format));
+	out.write(binary.data(), binary.size());
 }
 
-void hs::shader::set_uniform_raw(GLuint i, GLenum type, const void* p) const
+void hs::shader::set_uniform_raw(GLuint i, GLenum type, const void* p, GLsizei count) const
 {
 	bind();
 	switch (type)
 	{
 		case GL_INT:
-			glUniform1iv(i, 1, static_cast<const GLint*>(p));
+			glUniform1iv(i, count, static_cast<const GLint*>(p));
 			break;
 		case GL_FLOAT:
-			glUniform1fv(i, 1, static_cast<const GLfloat*>(p));
+			glUniform1fv(i, count, static_cast<const GLfloat*>(p));
 			break;
 		case GL_FLOAT_VEC2:
-			glUniform2fv(i, 1, static_cast<const GLfloat*>(p));
+			glUniform2fv(i, count, static_cast<const GLfloat*>(p));
 			break;
 		case GL_FLOAT_VEC3:
-			glUniform3fv(i, 1, static_cast<const GLfloat*>(p));
+			glUniform3fv(i, count, static_cast<const GLfloat*>(p));
 			break;
 		case GL_FLOAT_VEC4:
-			glUniform4fv(i, 1, static_cast<const GLfloat*>(p));
+			glUniform4fv(i, count, static_cast<const GLfloat*>(p));
 			break;
 		case GL_FLOAT_MAT4:
-			glUniformMatrix4fv(i, 1, GL_FALSE, static_cast<const GLfloat*>(p));
+			glUniformMatrix4fv(i, count, GL_FALSE, static_cast<const GLfloat*>(p));
 			break;
 	}
 }
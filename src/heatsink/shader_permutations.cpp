@@ -0,0 +1,48 @@
+#include <heatsink/shader_permutations.hpp>
+
+#include <cassert>
+#include <utility>
+
+hs::shader_permutations::shader_permutations(context& c, const std::vector<shader::stage>& stages,
+	const std::vector<std::string>& features, const std::vector<std::string>& defines, setup_function setup)
+	: m_context{c}, m_stages{stages}, m_features{features}, m_defines{defines}, m_setup{std::move(setup)}
+{
+	assert(features.size() <= sizeof(feature_mask) * 8);
+}
+
+void hs::shader_permutations::prepare(std::initializer_list<feature_mask> masks)
+{
+	for (auto m : masks)
+		find_or_build(m);
+}
+
+hs::shader& hs::shader_permutations::get(feature_mask features)
+{
+	auto& v = find_or_build(features);
+	if (!v.ready)
+	{
+		if (m_setup)
+			m_setup(v.program);
+
+		v.ready = true;
+	}
+
+	return v.program;
+}
+
+hs::shader_permutations::variant& hs::shader_permutations::find_or_build(feature_mask features)
+{
+	auto it = m_variants.find(features);
+	if (it != m_variants.end())
+		return it->second;
+
+	// A bit past the end of the list names no feature
+	assert(m_features.size() == sizeof(feature_mask) * 8 || (features >> m_features.size()) == 0);
+
+	auto defines = m_defines;
+	for (auto i = 0u; i != m_features.size(); ++i)
+		if (features & (feature_mask(1) << i))
+			defines.push_back(m_features[i]);
+
+	return m_variants.emplace(features, variant{shader(m_context, m_stages, defines), false}).first->second;
+}
@@ -0,0 +1,170 @@
+#include <heatsink/state_cache.hpp>
+
+namespace
+{
+	// GL contexts are current per thread, so the cache must be too
+	thread_local hs::state_cache* g_current = nullptr;
+}
+
+hs::state_cache* hs::state_cache::current()
+{
+	return g_current;
+}
+
+void hs::state_cache::make_current(state_cache& c)
+{
+	g_current = &c;
+}
+
+hs::state_cache::state_cache()
+	: m_stats{0, 0}
+{
+	invalidate();
+}
+
+bool hs::state_cache::use_program(GLuint name)
+{
+	return record(m_program, name);
+}
+
+bool hs::state_cache::bind_vertex_array(GLuint name)
+{
+	return record(m_vertex_array, name);
+}
+
+bool hs::state_cache::bind_buffer(GLenum mode, GLuint name)
+{
+	// The element buffer binding belongs to the bound vertex array
+	if (mode == GL_ELEMENT_ARRAY_BUFFER)
+	{
+		m_stats.issued += 1;
+		return true;
+	}
+
+	auto it = m_buffers.emplace(mode, unknown).first;
+	return record(it->second, name);
+}
+
+bool hs::state_cache::bind_framebuffer(GLenum mode, GLuint name)
+{
+	switch (mode)
+	{
+		case GL_DRAW_FRAMEBUFFER:
+			return record(m_draw_framebuffer, name);
+		case GL_READ_FRAMEBUFFER:
+			return record(m_read_framebuffer, name);
+		default:
+			break;
+	}
+
+	// GL_FRAMEBUFFER sets both targets at once
+	if (m_draw_framebuffer == name && m_read_framebuffer == name)
+	{
+		m_stats.elided += 1;
+		return false;
+	}
+
+	m_draw_framebuffer = m_read_framebuffer = name;
+	m_stats.issued += 1;
+	return true;
+}
+
+bool hs::state_cache::active_texture(size_t unit)
+{
+	if (m_active_unit == unit)
+	{
+		m_stats.elided += 1;
+		return false;
+	}
+
+	m_active_unit = unit;
+	m_stats.issued += 1;
+	return true;
+}
+
+bool hs::state_cache::bind_texture(size_t unit, GLenum mode, GLuint name)
+{
+	if (unit >= m_textures.size())
+		m_textures.resize(unit + 1);
+
+	auto it = m_textures[unit].emplace(mode, unknown).first;
+	return record(it->second, name);
+}
+
+bool hs::state_cache::bind_sampler(size_t unit, GLuint name)
+{
+	if (unit >= m_samplers.size())
+		m_samplers.resize(unit + 1, unknown);
+
+	return record(m_samplers[unit], name);
+}
+
+void hs::state_cache::bind_buffer_base(GLenum mode, GLuint name)
+{
+	m_buffers[mode] = name;
+}
+
+void hs::state_cache::forget(GLenum type, GLuint name)
+{
+	auto forget_name = [name](GLuint& bound) {
+		if (bound == name)
+			bound = unknown;
+	};
+
+	switch (type)
+	{
+		case GL_PROGRAM:
+			forget_name(m_program);
+			break;
+		case GL_VERTEX_ARRAY:
+			forget_name(m_vertex_array);
+			break;
+		case GL_FRAMEBUFFER:
+			forget_name(m_draw_framebuffer);
+			forget_name(m_read_framebuffer);
+			break;
+		case GL_BUFFER:
+			for (auto& b : m_buffers)
+				forget_name(b.second);
+			break;
+		case GL_TEXTURE:
+			for (auto& unit : m_textures)
+				for (auto& t : unit)
+					forget_name(t.second);
+			break;
+		case GL_SAMPLER:
+			for (auto& s : m_samplers)
+				forget_name(s);
+			break;
+		default:
+			invalidate();
+			break;
+	}
+}
+
+void hs::state_cache::invalidate()
+{
+	m_program = unknown;
+	m_vertex_array = unknown;
+	m_draw_framebuffer = unknown;
+	m_read_framebuffer = unknown;
+
+	m_active_unit = unknown;
+
+	m_buffers.clear();
+	m_textures.clear();
+	m_samplers.clear();
+}
+
+bool hs::state_cache::record(GLuint& bound, GLuint name)
+{
+	if (bound == name)
+	{
+		m_stats.elided += 1;
+		return false;
+	}
+
+	bound = name;
+	m_stats.issued += 1;
+	return true;
+}
@@ -0,0 +1,64 @@
+#include <heatsink/stream_buffer.hpp>
+
+#include <utility>
+
+hs::stream_buffer::stream_buffer(stream_buffer&& other)
+	: array_buffer(std::move(other)), m_capacity{other.m_capacity}, m_used{other.m_used},
+	  m_fences(std::move(other.m_fences)), m_region{other.m_region}, m_stalls{other.m_stalls}, m_data{other.m_data}
+{
+	other.m_fences.clear();
+	other.m_data = nullptr;
+}
+
+hs::stream_buffer::~stream_buffer()
+{
+	// Deleting the buffer also unmaps it, so only the fences are left
+	for (auto f : m_fences)
+		if (f)
+			glDeleteSync(f);
+}
+
+void hs::stream_buffer::allocate()
+{
+	// Immutable storage is core in 4.4; earlier contexts need the extension
+	assert(GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage);
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	auto bytes = m_capacity * m_fences.size() * this->stride();
+
+	bind();
+	glBufferStorage(this->m_mode, bytes, nullptr, flags);
+	m_data = static_cast<char*>(glMapBufferRange(this->m_mode, 0, bytes, flags));
+
+	assert(m_data);
+}
+
+void hs::stream_buffer::next_region()
+{
+	auto& left = m_fences[m_region];
+	if (left)
+		glDeleteSync(left);
+
+	left = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	m_region = (m_region + 1) % m_fences.size();
+	m_used = 0;
+
+	auto& next = m_fences[m_region];
+	if (!next)
+		return;
+
+	// Normally signalled long ago; only a GPU that is a whole ring behind blocks here
+	auto status = glClientWaitSync(next, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED)
+	{
+		m_stalls += 1;
+		while (status == GL_TIMEOUT_EXPIRED)
+			status = glClientWaitSync(next, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+	}
+
+	assert(status != GL_WAIT_FAILED);
+
+	glDeleteSync(next);
+	next = nullptr;
+}
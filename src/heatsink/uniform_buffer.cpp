@@ -0,0 +1,9 @@
+#include <heatsink/uniform_buffer.hpp>
+
+void hs::uniform_buffer::bind_base(size_t binding) const
+{
+	glBindBufferBase(this->m_mode, binding, this->m_name);
+
+	if (auto* cache = state_cache::current())
+		cache->bind_buffer_base(this->m_mode, this->m_name);
+}
@@ -12,14 +12,27 @@ void hs::vertex_array::set_attribute(attribute a, const array_buffer& b)
 
 	auto component_size = enum_sizeof(a.component);
 	auto size = b.stride() / component_size;
-	// FIXME: support for sequential matrix attributes
+
+	set_pointer(a, b, 1, size, b.stride(), 0);
+}
+
+void hs::vertex_array::set_pointer(attribute a, const array_buffer& b, size_t columns, size_t size, size_t stride, size_t offset)
+{
 	assert(size <= 4);
+	auto column_size = size * enum_sizeof(a.component);
 
 	bind();
-	glEnableVertexAttribArray(a.index);
-
 	b.bind();
-	glVertexAttribPointer(a.index, size, a.component, a.normalize, b.stride(), nullptr);
+
+	for (auto i = 0u; i != columns; ++i)
+	{
+		auto index = a.index + i;
+		auto* pointer = reinterpret_cast<GLvoid*>(offset + i * column_size);
+
+		glEnableVertexAttribArray(index);
+		glVertexAttribPointer(index, size, a.component, a.normalize, stride, pointer);
+		glVertexAttribDivisor(index, a.divisor);
+	}
 }
 
 void hs::vertex_array::set_elements(const array_buffer& b)
@@ -10,6 +10,13 @@ helper::assimp_model::assimp_model(const std::string& filename)
 	assert(((unsigned int)m_scene) != 0u);
 }
 
+helper::assimp_model::~assimp_model()
+{
+	// The scene is only needed until get_meshes/get_materials have copied it out
+	if (m_scene)
+		aiReleaseImport(m_scene);
+}
+
 auto helper::assimp_model::get_materials() const -> std::vector<material_data>
 {
 	const std::vector<aiTextureType> texture_types =
@@ -28,7 +28,14 @@ helper::stb_image::stb_image(const std::string& filename, GLenum format)
 	component_size = static_cast<size_t>((format == GL_NONE) ? bpp : cs);
 }
 
+helper::stb_image::stb_image(stb_image&& other)
+	: data{other.data}, width{other.width}, height{other.height}, component_size{other.component_size}
+{
+	other.data = nullptr;
+}
+
 helper::stb_image::~stb_image()
 {
-	stbi_image_free(static_cast<void*>(data));
+	if (data)
+		stbi_image_free(static_cast<void*>(data));
 }
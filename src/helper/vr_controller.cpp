@@ -4,67 +4,31 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/string_cast.hpp>
 
-namespace {
-	glm::mat4 make_mat4(const vr::HmdMatrix34_t& mat)
-	{
-		return glm::mat4{
-			mat.m[0][0], mat.m[1][0], mat.m[2][0], 0.0,
-			mat.m[0][1], mat.m[1][1], mat.m[2][1], 0.0,
-			mat.m[0][2], mat.m[1][2], mat.m[2][2], 0.0,
-			mat.m[0][3], mat.m[1][3], mat.m[2][3], 1.0f
-		};
-	}
-}
-
 namespace helper {
-	vr_controller::vr_controller(vr::IVRSystem* hmd, vr::ETrackedControllerRole role)
-	: m_hmd{hmd}, m_role{role}, m_index{vr::k_unTrackedDeviceIndexInvalid} {
-		this->update({});
+	vr_controller::vr_controller()
+	: m_model{1.f} {
 	}
 
-	void vr_controller::update(const std::vector<vr::TrackedDevicePose_t>& poses) {
-		if (m_index == vr::k_unTrackedDeviceIndexInvalid) {
-			for (int i = vr::k_unTrackedDeviceIndex_Hmd + 1; i < vr::k_unMaxTrackedDeviceCount; ++i) {
-				if (m_hmd->GetTrackedDeviceClass(i) != vr::ETrackedDeviceClass::TrackedDeviceClass_Controller)
-					continue;
-				if (m_hmd->GetControllerRoleForTrackedDeviceIndex(i) == m_role) {
-					m_index = i;
-					break;
-				}
-			}
-		}
-
-		if (m_index == vr::k_unTrackedDeviceIndexInvalid)
+	void vr_controller::update(const xr_device& device) {
+		if (!device.valid)
 			return;
-		if (!poses.size())
-			return;
-		if (!m_hmd->IsTrackedDeviceConnected(m_index))
-			return;
-
-		vr::VRControllerState_t state;
-		m_hmd->GetControllerState(m_index, &state, sizeof(state));
 
 		for (auto& h : m_handlers) {
 			bool old = h.second.is_pressed;
-			h.second.is_pressed = (h.first & state.ulButtonPressed) || (h.first & state.ulButtonTouched);
+			h.second.is_pressed = (h.first & device.buttons);
 			if (h.second.is_pressed != old)
 				h.second.callback(h.second.is_pressed);
 		}
 
-		if (poses[m_index].bPoseIsValid)
-			m_model = make_mat4(poses[m_index].mDeviceToAbsoluteTracking);
-	}
-
-	uint64_t vr_controller::get_index() const {
-		return m_index;
+		m_model = device.pose;
 	}
 
 	glm::mat4 vr_controller::get_model_matrix() const {
 		return m_model;
 	}
 
-	void vr_controller::attach_handler(vr::EVRButtonId id, handler h) {
-		m_handlers.try_emplace(vr::ButtonMaskFromId(id), h, false);
+	void vr_controller::attach_handler(xr_button id, handler h) {
+		m_handlers.try_emplace(id, h, false);
 	}
 
 	std::optional<glm::vec2> vr_controller::ray_intersect(const glm::vec3& origin, const glm::vec3& dir, const glm::vec3& pos, const glm::vec3& norm) {
@@ -117,28 +117,23 @@ instrument::instrument(hs::context& c, size_t voice, std::shared_ptr<audio::sour
 	m_model = model::get_model(get_model_path(get_family(voice)));
 }
 
-void instrument::draw(hs::shader& s, const std::set<std::string>& unis)
+model::instance instrument::get_instance() const
 {
-	// HACK: For use with cached versions of same model
-	m_model->position(m_position);
+	auto angle = std::atan2(m_position.z, -1 * m_position.x) + glm::radians(180.0f);
+	auto look = glm::rotate(glm::translate(glm::mat4(1.f), m_position), angle, glm::vec3{ 0,1,0 });
 
-	auto sunis = unis;
-	if (m_selected && sunis.count("Color"))
-		sunis.emplace("Selected");
-
-	auto angle = std::atan2(m_model->position().z, -1 * m_model->position().x) + glm::radians(180.0f);
-	auto look = glm::rotate(glm::mat4(1.f), angle, glm::vec3{ 0,1,0 });
-	m_model->draw(s, sunis, look);
+	auto tint = m_selected ? glm::vec3(0.3f, 0.f, 0.f) : glm::vec3(0.f);
+	return {look, tint};
 }
 
-void instrument::init(hs::context& context, const std::vector<char>& channels) {
+void instrument::init(loader& l, const std::vector<char>& channels) {
 	for (const auto& c : channels)
 	{
 		//std::cout << "Loading voice: " << (size_t)c << " with family: " << (int)get_family((size_t)c) << std::endl;
 
 		family fam = get_family(c);
 
-		// Try to load. Will cache on load
-		model::load_model(context, get_model_path(fam));
+		// Queue for loading. Each model path is only decoded once
+		l.queue_model(get_model_path(fam));
 	}
 }
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include <loader.hpp>
+
+#include <algorithm>
+
+#include <trace.hpp>
+
+loader::loader(size_t threads)
+: m_running{true}
+{
+	// hardware_concurrency() is allowed to report 0
+	threads = std::max<size_t>(threads, 1);
+
+	for (auto i = 0u; i != threads; ++i)
+	{
+		m_workers.emplace_back([this]() {
+			trace::name_thread("loader");
+
+			while (true)
+			{
+				std::function<void()> task;
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					m_ready.wait(lock, [this]() { return !m_running || !m_tasks.empty(); });
+
+					if (!m_running && m_tasks.empty())
+						return;
+
+					task = std::move(m_tasks.front());
+					m_tasks.pop();
+				}
+
+				TRACE_SCOPE("loader task");
+				task();
+			}
+		});
+	}
+}
+
+loader::~loader()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+
+	m_ready.notify_all();
+	for (auto& w : m_workers)
+		w.join();
+}
+
+void loader::queue_model(const std::string& path)
+{
+	if (m_models.count(path) || model::g_model_cache.count(path))
+		return;
+
+	m_models.emplace(path, submit([path]() { return model::import(path); }));
+}
+
+std::future<helper::stb_image> loader::queue_image(const std::string& path, GLenum format)
+{
+	return submit([path, format]() { return helper::stb_image(path, format); });
+}
+
+void loader::upload_models(geometry_arena& arena)
+{
+	for (auto& m : m_models)
+	{
+		auto meshes = m.second.get();
+		model::g_model_cache.emplace(m.first, std::make_shared<model>(arena, meshes));
+	}
+
+	m_models.clear();
+}
@@ -1,10 +1,20 @@
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <limits>
 #include <map>
-#include <numeric>
+#include <memory>
+#include <mutex>
 #include <queue>
+#include <sstream>
 #include <string>
+#include <thread>
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
@@ -14,58 +24,290 @@
 #include <glm/gtx/string_cast.hpp>
 #include <glm/gtx/transform.hpp>
 
-#include <openvr.h>
-
 #include <heatsink/glfw.hpp>
 #include <heatsink/window.hpp>
+#ifdef HEATSINK_EGL
+#include <heatsink/egl.hpp>
+#endif
 #include <heatsink/array_buffer.hpp>
 #include <heatsink/shader.hpp>
+#include <heatsink/shader_permutations.hpp>
 #include <heatsink/texture.hpp>
 #include <heatsink/vertex_array.hpp>
 #include <heatsink/framebuffer.hpp>
+#include <heatsink/gpu_profiler.hpp>
+#include <heatsink/sampler.hpp>
+#include <heatsink/uniform_buffer.hpp>
 
 #include <helper/stb.hpp>
 #include <helper/assimp.hpp>
 #include <helper/vr_controller.hpp>
 
 #include "model.hpp"
+#include "geometry_arena.hpp"
 #include "instrument.hpp"
+#include "loader.hpp"
+#include "openvr_runtime.hpp"
 #include "bpm.hpp"
+#include "double_buffer.hpp"
+#include "page_streamer.hpp"
+#include "simulated_hmd.hpp"
+#include "trace.hpp"
 
 #include <audio.hpp>
 #include <score.hpp>
 
 using namespace std::string_literals;
 
-glm::mat4 make_mat4(const vr::HmdMatrix34_t& mat)
+// SteamVR, or a simulated headset when VRCONDUCT_SIMULATE is set
+/* VRCONDUCT_SIMULATE names a pose script, or is "default" for the built-in one.
+* VRCONDUCT_SIMULATE_REFRESH sets the refresh rate in Hz (0 for unpaced), and
+* VRCONDUCT_SIMULATE_SIZE the size of one eye, as WIDTHxHEIGHT. Returns null,
+* after saying why, if any of them cannot be used
+*/
+std::unique_ptr<xr_runtime> make_runtime()
 {
-	return glm::mat4{
-		mat.m[0][0], mat.m[1][0], mat.m[2][0], 0.0,
-		mat.m[0][1], mat.m[1][1], mat.m[2][1], 0.0,
-		mat.m[0][2], mat.m[1][2], mat.m[2][2], 0.0,
-		mat.m[0][3], mat.m[1][3], mat.m[2][3], 1.0f
-	};
+	auto script = std::getenv("VRCONDUCT_SIMULATE");
+	if (!script)
+		return std::make_unique<openvr_runtime>();
+
+	simulated_hmd::settings settings;
+	if (auto refresh = std::getenv("VRCONDUCT_SIMULATE_REFRESH"))
+	{
+		char* end = nullptr;
+		settings.refresh_rate = std::strtof(refresh, &end);
+
+		if (end == refresh || *end != '\0' || !(settings.refresh_rate >= 0.f)) {
+			std::clog << "VRCONDUCT_SIMULATE_REFRESH must be a rate in Hz, or 0 for unpaced" << std::endl;
+			return nullptr;
+		}
+	}
+
+	if (auto size = std::getenv("VRCONDUCT_SIMULATE_SIZE"))
+	{
+		char* x = nullptr;
+		char* end = nullptr;
+		auto width = std::strtol(size, &x, 10);
+		auto height = (*x == 'x') ? std::strtol(x + 1, &end, 10) : 0;
+
+		if (x == size || !end || end == x + 1 || *end != '\0' || width <= 0 || height <= 0) {
+			std::clog << "VRCONDUCT_SIMULATE_SIZE must be WIDTHxHEIGHT, both greater than 0" << std::endl;
+			return nullptr;
+		}
+
+		settings.render_size = {static_cast<unsigned>(width), static_cast<unsigned>(height)};
+	}
+
+	if (script == "default"s)
+		return std::make_unique<simulated_hmd>(settings);
+
+	std::ifstream in(script);
+	if (!in) {
+		std::clog << "pose script " << script << " could not be opened" << std::endl;
+		return nullptr;
+	}
+
+	return std::make_unique<simulated_hmd>(settings, in);
 }
 
-glm::mat4 make_mat4(const vr::HmdMatrix44_t& mat)
+// Wall time without a window system, so every backend keeps the same clock
+double seconds_since(std::chrono::steady_clock::time_point start)
 {
-	return glm::mat4{
-		mat.m[0][0], mat.m[1][0], mat.m[2][0], mat.m[3][0],
-		mat.m[0][1], mat.m[1][1], mat.m[2][1], mat.m[3][1],
-		mat.m[0][2], mat.m[1][2], mat.m[2][2], mat.m[3][2],
-		mat.m[0][3], mat.m[1][3], mat.m[2][3], mat.m[3][3]
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Poses latched by the render thread, copied to the simulation each frame
+struct frame_input
+{
+public:
+	xr_device head;
+	std::array<xr_device, 2> hands;
+};
+
+// The scene as of one simulation step, for the render thread
+/* Changes are counted rather than flagged, so none are lost when the render
+* thread skips a snapshot. Head and hand poses are not here; the render thread
+* latches its own, newer ones
+*/
+struct scene_snapshot
+{
+public:
+	struct member
+	{
+	public:
+		std::shared_ptr<model> shape;
+		model::instance instance;
+		// Being dragged, so drawn with the dynamic casters
+		bool moving;
 	};
+
+public:
+	std::vector<member> ensemble;
+
+	bool select_mode = false;
+	glm::mat4 world_scale{1.f};
+
+	size_t static_version = 0;
+	size_t miniature_version = 0;
+
+	glm::vec3 listener_position{0.f};
+	// Look, then up, as AL_ORIENTATION takes them
+	std::array<float, 6> listener_orientation{};
+
+	size_t page = 0;
+};
+
+// How far, in metres, culling keeps objects outside the eye views; see openvr_runtime::latch
+constexpr float late_latch_margin = 0.25f;
+
+// CPU layouts of the std140 uniform blocks shared by every shader
+// Frame constants are written once per frame
+struct frame_block
+{
+	glm::mat4 shadow_vp;
+	float shadow_bias;
+	float padding[3];
+};
+
+// View constants are written once per view; the eyes share a single view
+struct view_block
+{
+	glm::mat4 vp[2];
+	glm::mat4 skybox_vp[2];
+};
+
+constexpr size_t frame_binding = 0;
+constexpr size_t view_binding = 1;
+
+// The shadow map has a unit of its own, since it needs a comparison sampler
+constexpr size_t shadow_unit = 2;
+// Points towards the light, which never moves; it is built into the programs as a constant
+const glm::vec3 light_direction = glm::normalize(glm::vec3{-0.5f, 1.f, -1.f});
+
+// Features the scene program is specialized on (see hs::shader_permutations)
+// Each draw uses the variant with only the features it needs
+enum scene_feature : hs::shader_permutations::feature_mask
+{
+	// Each instance is drawn once per eye (see view_index in view.glsl)
+	stereo_feature = 1 << 0,
+	// Reads the per-instance tint; only a selected instrument has one
+	tint_feature = 1 << 1,
+	// Filters shadows as eye_shadow_define sets; without it, a single 2x2 lookup
+	soft_shadow_feature = 1 << 2
+};
+
+// Shadow filtering of everything the eyes see up close: the scene and the page
+// 1 is a 3x3 grid of 2x2 lookups (see shadow in lighting.glsl)
+constexpr const char* eye_shadow_define = "SHADOW_RINGS 1";
+
+// The #define of each scene_feature, in bit order
+const std::vector<std::string> scene_features = {model::stereo_define, "SELECTION_TINT", eye_shadow_define};
+
+// A vec3 #define, to build a constant into a program
+std::string glsl_define(const std::string& name, const glm::vec3& v)
+{
+	std::ostringstream s;
+	s << name << " vec3(" << std::fixed << v.x << ", " << v.y << ", " << v.z << ")";
+
+	return s.str();
+}
+
+// Passes of the render queue, submitted in this order
+// Static shadow casters are only drawn when the cached shadow map is out of date
+// Likewise, the select mode miniature is only drawn when something in it changes
+// The skybox is separate from the eyes since it is drawn without depth writes
+enum render_pass : size_t { static_shadow_pass, shadow_pass, miniature_pass, sky_pass, eye_pass };
+
+// Bounds of the light projection are rounded out to this many metres
+constexpr float shadow_fit_step = 2.f;
+// Room left towards the light for the dynamic casters, which are not part of the fit
+constexpr float shadow_caster_headroom = 2.f;
+
+// Fit an orthographic light projection around the receivers the eyes can see
+/* Only static geometry is fitted, and its bounds are rounded out to coarse
+* steps, so the projection (and with it the cached static shadow) stays the same
+* while the baton or a dragged instrument moves, and only changes when the view
+* moves noticeably. Casters only pull the near plane towards the light, so
+* shadows from outside the view still land. The center is snapped to whole
+* texels of the map, which keeps the shadow edges from shimmering
+*/
+glm::mat4 fit_shadow_projection(const glm::mat4& light_view, const std::vector<glm::vec4>& receivers, const std::vector<glm::vec4>& casters,
+                                GLsizei map_size)
+{
+	if (receivers.empty())
+		return glm::ortho(-1.f, 1.f, -1.f, 1.f, 0.f, 1.f);
+
+	auto lo = glm::vec3(std::numeric_limits<float>::max());
+	auto hi = glm::vec3(std::numeric_limits<float>::lowest());
+
+	for (auto& s : receivers)
+	{
+		auto c = glm::vec3(light_view * glm::vec4(glm::vec3(s), 1.f));
+		lo = glm::min(lo, c - glm::vec3(s.w));
+		hi = glm::max(hi, c + glm::vec3(s.w));
+	}
+
+	// The light looks down -z, so the near plane is at the largest z
+	for (auto& s : casters)
+	{
+		auto c = glm::vec3(light_view * glm::vec4(glm::vec3(s), 1.f));
+		hi.z = std::max(hi.z, c.z + s.w);
+	}
+
+	// Snapping the center can move it by half a step, which the extra step covers
+	auto extent = (std::ceil(std::max(hi.x - lo.x, hi.y - lo.y) / shadow_fit_step) + 1.f) * shadow_fit_step;
+	auto center = glm::round((glm::vec2(lo) + glm::vec2(hi)) * 0.5f / shadow_fit_step) * shadow_fit_step;
+
+	// The map spans a whole number of texels either side of the center, so a
+	// texel-aligned center keeps every texel on the same grid in light space
+	auto texel = extent / static_cast<float>(map_size);
+	center = glm::round(center / texel) * texel;
+
+	auto near_plane = std::floor((-hi.z - shadow_caster_headroom) / shadow_fit_step) * shadow_fit_step;
+	auto far_plane = std::ceil(-lo.z / shadow_fit_step) * shadow_fit_step;
+
+	return glm::ortho(center.x - extent * 0.5f, center.x + extent * 0.5f,
+	                  center.y - extent * 0.5f, center.y + extent * 0.5f, near_plane, far_plane);
 }
 
 int main(int argc, char** argv)
 {
-	if (argc != 2) {
-		std::clog << "usage: " << argv[0] << " path/to/data/dir" << std::endl;
+	if (argc != 2 && argc != 3) {
+		std::clog << "usage: " << argv[0] << " path/to/data/dir [shadow map size]" << std::endl;
 		return 1;
 	}
 
 	auto path = std::string(argv[1]);
 
+	// The light frustum is fitted to the scene, so a smaller map can be as sharp as
+	// the old fixed 4096 map over the whole world
+	GLsizei shadow_size = 2048;
+	if (argc == 3)
+	{
+		char* end = nullptr;
+		shadow_size = static_cast<GLsizei>(std::strtol(argv[2], &end, 10));
+
+		// Anything but a whole number is rejected by the check below
+		if (end == argv[2] || *end != '\0')
+			shadow_size = 0;
+	}
+
+	if (shadow_size != 1024 && shadow_size != 2048 && shadow_size != 4096) {
+		std::clog << "shadow map size must be 1024, 2048 or 4096" << std::endl;
+		return 1;
+	}
+
+	// Before anything else starts, so a bad setting stops the program cleanly
+	auto runtime = make_runtime();
+	if (!runtime)
+		return 1;
+
+	auto launch_time = std::chrono::steady_clock::now();
+
+	// Tracing can also be toggled with the left menu button; see trace.json on exit
+	trace::enable(std::getenv("VRCONDUCT_TRACE") != nullptr);
+	trace::name_thread("main");
+
 	std::cout << "Devices:" << std::endl;
 	for (const auto& d : audio::enumerate_devices())
 		std::cout << "\tAUD: " << d << std::endl;
@@ -82,6 +324,43 @@ int main(int argc, char** argv)
 		aud.get_frequency()
 	);
 
+	// Start decoding assets while the audio, VR and GL setup happens
+	// Only the instrument families that the score actually uses are loaded
+	loader assets;
+	instrument::init(assets, s.get_channel_presets());
+
+	assets.queue_model(path + "/model/stage2.obj");
+	assets.queue_model(path + "/model/baton2.obj");
+	assets.queue_model(path + "/model/baton3.obj");
+	assets.queue_model(path + "/model/cube.obj");
+	assets.queue_model(path + "/model/stand.obj");
+
+	// Pages are numbered from 1, and the score has as many as there are files
+	std::vector<std::string> page_paths;
+	for (auto i = 1u; std::ifstream(path + "/music/con1/con1-" + std::to_string(i) + ".png").good(); ++i)
+		page_paths.push_back(path + "/music/con1/con1-" + std::to_string(i) + ".png");
+
+	if (page_paths.empty()) {
+		std::clog << "no score pages found at " << path << "/music/con1/con1-1.png" << std::endl;
+		return 1;
+	}
+
+	auto first_page = assets.queue_image(page_paths.front(), GL_RGBA);
+
+	const std::vector<std::string> skybox_images =
+	{
+		path + "/texture/sky/right.tga",
+		path + "/texture/sky/left.tga",
+		path + "/texture/sky/top.tga",
+		path + "/texture/sky/bottom.tga",
+		path + "/texture/sky/back.tga",
+		path + "/texture/sky/front.tga"
+	};
+
+	std::vector<std::future<helper::stb_image>> skybox_faces;
+	for (auto& i : skybox_images)
+		skybox_faces.push_back(assets.queue_image(i, GL_RGB));
+
 	auto cs = s.get_channels();
 	std::map<size_t, std::pair<std::shared_ptr<score::channel>, std::shared_ptr<audio::source>>> mappings;
 	for (auto& c : cs) {
@@ -95,6 +374,8 @@ int main(int argc, char** argv)
 
 	// Fill buffers
 	auto f = std::thread([&]() {
+		trace::name_thread("fill");
+
 		while (should_run) {
 			if (!s.is_playing()) {
 				std::this_thread::yield();
@@ -121,6 +402,8 @@ int main(int argc, char** argv)
 
 	// Generate audio
 	auto w = std::thread([&]() {
+		trace::name_thread("source restart");
+
 		while (should_run) {
 			if (!s.is_playing()) {
 				std::this_thread::yield();
@@ -132,6 +415,8 @@ int main(int argc, char** argv)
 				assert(error == AL_NO_ERROR);
 
 				if (state != AL_PLAYING) {
+					TRACE_SCOPE("restart source");
+
 					audio::get_error();
 					alSourcePlay(*get_source(m));
 					auto e = audio::get_error();
@@ -143,45 +428,65 @@ int main(int argc, char** argv)
 		}
 	});
 
-	vr::EVRInitError vr_error;
-	auto* hmd = vr::VR_Init(&vr_error, vr::EVRApplicationType::VRApplication_Scene);
-	assert(vr_error == vr::VRInitError_None);
+	auto hmd_size = runtime->render_size();
+	unsigned int hmd_width = hmd_size.x, hmd_height = hmd_size.y;
 
-	auto* vr_compositor = vr::VRCompositor();
-	assert(vr_compositor);
+	// Fed the hands the render thread latches; see frame_input
+	helper::vr_controller left_controller;
+	helper::vr_controller right_controller;
 
-	unsigned int hmd_width, hmd_height;
-	hmd->GetRecommendedRenderTargetSize(&hmd_width, &hmd_height);
+	// Poses can be recorded from any runtime, and played back with VRCONDUCT_SIMULATE
+	std::ofstream pose_record;
+	if (auto path = std::getenv("VRCONDUCT_RECORD_POSES"))
+		pose_record.open(path);
 
-	// Get controllers
-	helper::vr_controller left_controller(hmd, vr::TrackedControllerRole_LeftHand);
-	helper::vr_controller right_controller(hmd, vr::TrackedControllerRole_RightHand);
+	std::chrono::steady_clock::time_point record_start;
 
-	hs::settings settings(4, 0);
-	hs::backend::init(settings);
+	// Multi-draw indirect with base instances needs 4.3
+	hs::settings settings(4, 3);
+	glm::uvec2 window_size(hmd_width / 2, hmd_height / 2);
 
-	hs::backend::window window("conductor", {hmd_width/2.f, hmd_height/2.f});
-	auto& context = window.get_context();
+	std::unique_ptr<hs::window> window;
+#ifdef HEATSINK_EGL
+	// Render offscreen, eg for benchmarks; VRCONDUCT_HEADLESS=n stops after n frames (0 runs forever)
+	if (auto frames = std::getenv("VRCONDUCT_HEADLESS"))
+	{
+		hs::backend::egl::init(settings);
+		window = std::make_unique<hs::backend::egl::window>("conductor", window_size, std::strtoul(frames, nullptr, 10));
+	}
+#endif
+	if (!window)
+	{
+		hs::backend::init(settings);
+		window = std::make_unique<hs::backend::window>("conductor", window_size);
+	}
 
-	std::vector<char> presets(256);
-	std::iota(presets.begin(), presets.end(), 0);
-	instrument::init(context, presets);
+	auto& context = window->get_context();
 
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LEQUAL);
 
-	hs::shader shader(context,
+	// Linked programs are kept here, and loaded instead of compiled while nothing changes
+	hs::shader::set_binary_cache("shader_cache");
+
+	auto light = glsl_define("LIGHT_DIRECTION", light_direction);
+
+	// Every program is started before any is used, so the driver can build them all at once
+	hs::shader_permutations scene_shaders(context,
 	{
 		path + "/shader/simple.vert"s,
 		path + "/shader/simple.frag"s
+	}, scene_features, {light}, [](hs::shader& s) {
+		s.declare_uniform_block<frame_block>("Frame", frame_binding);
+		s.declare_uniform_block<view_block>("View", view_binding);
+		s.declare_uniform("Shadow", shadow_unit);
 	});
 
-	shader.declare_uniform("M", glm::mat4(1.f));
-	shader.declare_uniform<glm::mat4>("VP");
-	shader.declare_uniform<glm::mat4>("ShadowVP");
-	shader.declare_uniform<glm::vec3>("Color");
-	shader.declare_uniform<glm::vec3>("Selected");
-	shader.declare_uniform("Shadow", 0);
+	// The miniature is a small capture, so it is not worth filtering its shadows
+	hs::shader_permutations::feature_mask eye_features = stereo_feature | soft_shadow_feature;
+	hs::shader_permutations::feature_mask miniature_features = 0;
+
+	scene_shaders.prepare({eye_features, eye_features | tint_feature, miniature_features, miniature_features | tint_feature});
 
 	hs::shader shadow_shader(context,
 	{
@@ -189,17 +494,11 @@ int main(int argc, char** argv)
 		path + "/shader/shadow.frag"s
 	});
 
-	shadow_shader.declare_uniform("M", glm::mat4(1.0f));
-	shadow_shader.declare_uniform<glm::mat4>("VP");
-
 	hs::shader skybox_shader(context,
 	{
 		path + "/shader/skybox.vert"s,
 		path + "/shader/skybox.frag"s
-	});
-
-	skybox_shader.declare_uniform<glm::mat4>("VP");
-	skybox_shader.declare_uniform("Skybox", 0);
+	}, {model::stereo_define});
 
 	hs::shader quad_shader(context,
 	{
@@ -207,41 +506,130 @@ int main(int argc, char** argv)
 		path + "/shader/quad.frag"s
 	});
 
-	quad_shader.declare_uniform("Texture", 0);
-
+	// The page is only seen from up close, so it gets the eyes' shadow quality
 	hs::shader page_shader(context,
 	{
 		path + "/shader/page.vert"s,
 		path + "/shader/page.frag"s
-	});
+	}, {model::stereo_define, eye_shadow_define, light});
 
-	page_shader.declare_uniform<glm::mat4>("M");
-	page_shader.declare_uniform<glm::mat4>("VP");
+	hs::shader impostor_shader(context,
+	{
+		path + "/shader/impostor.vert"s,
+		path + "/shader/impostor.frag"s
+	}, {model::stereo_define});
+
+	// Variants live as long as scene_shaders, so the draw queue can hold on to them
+	auto& eye_shader = scene_shaders.get(eye_features);
+	auto& eye_tint_shader = scene_shaders.get(eye_features | tint_feature);
+	auto& miniature_shader = scene_shaders.get(miniature_features);
+	auto& miniature_tint_shader = scene_shaders.get(miniature_features | tint_feature);
+
+	shadow_shader.declare_uniform_block<view_block>("View", view_binding);
+
+	skybox_shader.declare_uniform_block<view_block>("View", view_binding);
+	skybox_shader.declare_uniform("Skybox", 0);
+
+	quad_shader.declare_uniform("Texture", 0);
+	// Mirror only the left eye of the side-by-side target
+	quad_shader.declare_uniform("Bounds", glm::vec4(0.f, 0.f, 0.5f, 1.f));
+
+	page_shader.declare_uniform_block<frame_block>("Frame", frame_binding);
+	page_shader.declare_uniform_block<view_block>("View", view_binding);
+	auto page_shader_m = page_shader.declare_uniform<glm::mat4>("M");
+	auto page_shader_layer = page_shader.declare_uniform<GLint>("Layer");
 	page_shader.declare_uniform("Texture", 0);
-	page_shader.declare_uniform<glm::mat4>("ShadowVP");
-	page_shader.declare_uniform("Shadow", 1);
+	page_shader.declare_uniform("Shadow", shadow_unit);
 
-	hs::framebuffer left_eye_buffer(context, {hmd_width, hmd_height});
-	left_eye_buffer.set_attachments({GL_RGB}, GL_DEPTH_COMPONENT24);
-	left_eye_buffer.get_color(0).set_filter(GL_LINEAR, GL_LINEAR);
+	impostor_shader.declare_uniform_block<view_block>("View", view_binding);
+	auto impostor_shader_m = impostor_shader.declare_uniform<glm::mat4>("M");
+	impostor_shader.declare_uniform("Texture", 0);
 
-	hs::framebuffer right_eye_buffer(context, {hmd_width, hmd_height});
-	right_eye_buffer.set_attachments({GL_RGB}, GL_DEPTH_COMPONENT24);
-	right_eye_buffer.get_color(0).set_filter(GL_LINEAR, GL_LINEAR);
+	auto programs = hs::shader::get_cache_statistics();
+	std::cout << "Shader programs: " << programs.loaded << " loaded from cache, " << programs.compiled << " compiled" << std::endl;
 
-	hs::framebuffer shadow_buffer(context, {4096, 4096});
-	shadow_buffer.set_attachments({}, GL_DEPTH_COMPONENT24);
-	shadow_buffer.get_depth().set_filter(GL_LINEAR, GL_LINEAR);
+	auto frame_uniforms = hs::uniform_buffer::empty<frame_block>(context);
+	auto eye_uniforms = hs::uniform_buffer::empty<view_block>(context);
+	auto shadow_uniforms = hs::uniform_buffer::empty<view_block>(context);
+	auto miniature_uniforms = hs::uniform_buffer::empty<view_block>(context);
 
-	auto stage = model::load_model(context, path + "/model/stage2.obj");
-	stage->position({0.f, 0.f, 0.f});
+	// Binding through the default identifier keeps the state cache in sync
+	auto screen_buffer = hs::context::identifier<GL_FRAMEBUFFER>::get_default(GL_FRAMEBUFFER);
+	size_t frame_count = 0;
+	// Objects drawn and culled by each pass, summed over every frame
+	std::array<cull_stats, eye_pass + 1> pass_stats{};
 
-	auto baton = model::load_model(context, path + "/model/baton2.obj");
-	auto select_baton = model::load_model(context, path + "/model/baton3.obj");
-	auto skybox = model::load_model(context, path + "/model/cube.obj");
+	// GPU and CPU time of each pass, printed on exit
+	hs::gpu_profiler profiler;
 
-	auto stand = model::load_model(context, path + "/model/stand.obj");
-	stand->position({0.0f, 0.0f, 0.0f});
+	// Every model is sub-allocated from here, so a pass is a handful of multi-draws
+	geometry_arena arena(context);
+	hs::render_queue draw_queue(context);
+
+	// The left eye is drawn to the left half, and the right eye to the right half
+	hs::framebuffer eye_buffer(context, {hmd_width * 2, hmd_height});
+	eye_buffer.set_attachments({GL_RGB}, GL_DEPTH_COMPONENT24);
+	eye_buffer.get_color(0).set_filter(GL_LINEAR, GL_LINEAR);
+
+	hs::framebuffer shadow_buffer(context, {shadow_size, shadow_size});
+	shadow_buffer.set_attachments({}, GL_DEPTH_COMPONENT24);
+
+	// Outside the map is never shadowed
+	hs::sampler shadow_sampler(context);
+	shadow_sampler.set_filter(GL_LINEAR, GL_LINEAR);
+	shadow_sampler.set_wrap(GL_CLAMP_TO_BORDER, GL_CLAMP_TO_BORDER);
+	shadow_sampler.set_border(glm::vec4(1.f));
+	shadow_sampler.set_compare(GL_LEQUAL);
+
+	// Depth of everything that cannot move on its own; copied into shadow_buffer each frame
+	hs::framebuffer static_shadow_buffer(context, {shadow_size, shadow_size});
+	static_shadow_buffer.set_attachments({}, GL_DEPTH_COMPONENT24);
+	bool static_shadow_dirty = true;
+
+	// The select mode miniature is captured once from above, and shown as a single textured quad
+	// It is only recaptured when an instrument in it moves or changes; see miniature_pass
+	constexpr GLsizei miniature_size = 1024;
+	hs::framebuffer miniature_buffer(context, {miniature_size, miniature_size});
+	miniature_buffer.set_attachments({GL_RGBA8}, GL_DEPTH_COMPONENT24);
+	// The impostor shows the capture at a fraction of its size, so it is mipmapped after each one
+	miniature_buffer.get_color(0).set_filter(GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+	bool miniature_dirty = true;
+
+	// Blocks until the workers have decoded every queued model
+	assets.upload_models(arena);
+
+	auto stage = model::load_model(arena, path + "/model/stage2.obj");
+
+	auto baton = model::load_model(arena, path + "/model/baton2.obj");
+	auto select_baton = model::load_model(arena, path + "/model/baton3.obj");
+	auto skybox = model::load_model(arena, path + "/model/cube.obj");
+
+	auto stand = model::load_model(arena, path + "/model/stand.obj");
+	glm::vec3 stand_position{0.0f, 0.0f, 0.0f};
+
+	// The capture covers the stage, looking straight down; +x is right and -z is up in the image
+	auto& stage_bounds = stage->get_bounds();
+	auto miniature_center = glm::vec2(stage_bounds.center.x, stage_bounds.center.z);
+	auto miniature_extent = glm::vec2(stage_bounds.max.x, stage_bounds.max.z) - miniature_center;
+	auto miniature_top = stage_bounds.max.y + 5.f;
+
+	auto miniature_proj = glm::ortho(-miniature_extent.x, miniature_extent.x, -miniature_extent.y, miniature_extent.y,
+	                                 0.f, miniature_top - stage_bounds.min.y + 1.f);
+	auto miniature_view = glm::lookAt(glm::vec3(miniature_center.x, miniature_top, miniature_center.y),
+	                                  glm::vec3(miniature_center.x, 0.f, miniature_center.y), glm::vec3(0.f, 0.f, -1.f));
+
+	view_block miniature_constants{};
+	miniature_constants.vp[0] = miniature_proj * miniature_view;
+	miniature_uniforms.update(miniature_constants);
+
+	// Stretch the -1 to 1 quad over the captured rectangle, on the floor the instruments stand on
+	// Under world_scale, the instruments' positions then land where they appear in the image
+	const glm::mat4 miniature_placement{
+		glm::vec4(miniature_extent.x, 0.f, 0.f, 0.f),
+		glm::vec4(0.f, 0.f, -miniature_extent.y, 0.f),
+		glm::vec4(0.f, 1.f, 0.f, 0.f),
+		glm::vec4(miniature_center.x, 0.f, miniature_center.y, 1.f)
+	};
 
 	std::vector<glm::vec2> quad_verts =
 	{
@@ -295,30 +683,16 @@ int main(int argc, char** argv)
 	page.set_attribute(1, page_coord);
 	page.set_attribute(2, page_norm);
 
-	auto page_img = helper::stb_image(path + "/music/con1/con1-1.png", GL_RGBA);
-	auto page_texture = std::make_shared<hs::texture2>(context, GL_TEXTURE_2D, page_img.size());
-	page_texture->set_filter(GL_LINEAR, GL_LINEAR);
-
-	hs::texture2::target page_target(GL_RGBA);
-	page_texture->update(GL_RGBA, page_target, page_img.data, page_img.data + page_img.data_size());
-
-	const std::vector<std::string> skybox_images =
-	{
-		path + "/texture/sky/right.tga",
-		path + "/texture/sky/left.tga",
-		path + "/texture/sky/top.tga",
-		path + "/texture/sky/bottom.tga",
-		path + "/texture/sky/back.tga",
-		path + "/texture/sky/front.tga"
-	};
+	// Later pages are decoded and uploaded in the background as playback reaches them
+	page_streamer pages(context, assets, page_paths, std::move(first_page));
 
 	hs::texture2 skybox_texture(context, GL_TEXTURE_CUBE_MAP, {1024, 1024});
 	skybox_texture.set_filter(GL_LINEAR, GL_LINEAR);
 
 	auto face = GL_TEXTURE_CUBE_MAP_POSITIVE_X;
-	for (auto& i : skybox_images)
+	for (auto& i : skybox_faces)
 	{
-		auto img = helper::stb_image(i, GL_RGB);
+		auto img = i.get();
 
 		hs::texture2::target target(GL_RGB, 0, face++);
 		skybox_texture.update(GL_RGB, target, img.data, img.data + img.data_size());
@@ -341,8 +715,9 @@ int main(int argc, char** argv)
 	glm::vec3 camera_position{-1.f, 1.f, 0.f};
 	float camera_angle{0.f};
 
-	auto shadow_proj = glm::ortho(-15.f, 15.f, -15.f, 15.f, 0.f, 30.f);
-	auto shadow_position = glm::vec3(15.f) * glm::normalize(glm::vec3{-0.5f, 1.f, -1.f});
+	// Refitted every frame; see fit_shadow_projection
+	auto shadow_proj = glm::mat4(1.f);
+	auto shadow_position = glm::vec3(15.f) * light_direction;
 	auto shadow_view = glm::lookAt(shadow_position, glm::vec3{}, glm::vec3{0.f, 1.f, 0.f});
 
 	auto flip_model = glm::scale(glm::mat4(1.f), glm::vec3{-1.f, 1.f, -1.f});
@@ -350,17 +725,20 @@ int main(int argc, char** argv)
 	glm::vec3 camera_up{ 0.f, 1.f, 0.f };
 	glm::vec3 camera_forward{ 0.f, 0.f, 1.f };
 
-	std::vector<vr::TrackedDevicePose_t> poses(vr::k_unMaxTrackedDeviceCount);
-
+	// Simulation state; only touched by the simulation thread, and the callbacks it runs
 	bool select_mode = false;
 	glm::mat4 hand_view;
 	glm::vec3 hand_pos{};
 
 	glm::mat4 world_scale(1.f);
 
+	// Bumped whenever the static casters or the miniature change; start ahead of the empty first snapshot
+	size_t static_version = 1;
+	size_t miniature_version = 1;
+
 	// Callbacks
 	instrument* selected = nullptr;
-	right_controller.attach_handler(vr::EVRButtonId::k_EButton_SteamVR_Trigger, [&](bool pressed) {
+	right_controller.attach_handler(xr_trigger, [&](bool pressed) {
 		if (pressed) {
 			if (!select_mode) {
 				s.play();
@@ -376,6 +754,9 @@ int main(int argc, char** argv)
 					selected = &inst.second;
 
 					inst.second.selected(true);
+					// The instrument is now a dynamic caster, and tinted in the miniature
+					static_version += 1;
+					miniature_version += 1;
 					break;
 				}
 			}
@@ -383,200 +764,532 @@ int main(int argc, char** argv)
 			if (selected) {
 				selected->selected(false);
 				selected = nullptr;
+
+				// Its new position is static again
+				static_version += 1;
+				miniature_version += 1;
 			}
 		}
 	});
 
-	right_controller.attach_handler(vr::EVRButtonId::k_EButton_ApplicationMenu, [&](bool pressed) {
-		if (pressed)
+	left_controller.attach_handler(xr_menu, [&](bool pressed) {
+		if (pressed) {
+			trace::enable(!trace::enabled());
+			std::cout << "Tracing " << (trace::enabled() ? "on" : "off") << std::endl;
+		}
+	});
+
+	right_controller.attach_handler(xr_menu, [&](bool pressed) {
+		if (pressed) {
 			select_mode = !select_mode;
+			// The full size stand is hidden in select mode
+			static_version += 1;
+			miniature_version += 1;
+		}
 	});
 
 	constexpr float scale_factor = 15.f;
-	while (window.refresh())
+
+	// The newest poses from the render thread; the simulation steps once for each new set
+	std::mutex input_mutex;
+	std::condition_variable input_ready;
+	frame_input latest_input;
+	size_t input_frame = 0;
+	bool simulating = true;
+
+	double_buffer<scene_snapshot> snapshots;
+
+	// Input, the score and instrument moves run here, so a slow step costs the render thread
+	// an old snapshot rather than a dropped frame
+	auto simulation = std::thread([&]() {
+		trace::name_thread("simulation");
+
+		size_t seen = 0;
+		while (true)
+		{
+			frame_input input;
+			{
+				std::unique_lock<std::mutex> lock(input_mutex);
+				input_ready.wait(lock, [&] { return (input_frame != seen || !simulating); });
+
+				if (!simulating)
+					break;
+
+				input = latest_input;
+				seen = input_frame;
+			}
+
+			TRACE_SCOPE("simulate");
+
+			left_controller.update(input.hands[0]);
+			right_controller.update(input.hands[1]);
+
+			hand_view = right_controller.get_model_matrix();
+			hand_pos = glm::vec3(hand_view * glm::vec4{ 0,0,0,1 });
+
+			world_scale = glm::mat4(1.0f);
+			if (select_mode) {
+				auto standp = stand_position;
+				standp.y += 0.85f;
+
+				world_scale = glm::scale(glm::rotate(glm::translate(standp), glm::radians(20.f), glm::vec3{1.f, 0.f, 0.f}), glm::vec3(1.f / scale_factor));
+			}
+
+			if (selected) {
+				auto h = hand_pos * scale_factor + glm::mat3(hand_view) * glm::vec3(0.f, 0.f, -0.3f) * scale_factor;
+				auto p = selected->position();
+
+				selected->position(glm::vec3{h.x, p.y, h.z});
+				miniature_version += 1;
+			} else {
+				current_bpm.update(hand_pos + glm::mat3(hand_view) * glm::vec3(0.f, 0.f, -0.3f), seconds_since(launch_time));
+				// Inform channel streams
+			}
+
+			auto camera_view = glm::mat4(1.f);
+			if (input.head.valid)
+				camera_view = glm::inverse(input.head.pose);
+
+			auto cam_look = glm::mat3(camera_view) * camera_forward;
+			auto cam_norm = glm::mat3(camera_view) * camera_up;
+
+			auto& next = snapshots.begin_write();
+
+			next.ensemble.clear();
+			for (auto& inst : instruments)
+				next.ensemble.push_back({inst.second.get_model(), inst.second.get_instance(), &inst.second == selected});
+
+			next.select_mode = select_mode;
+			next.world_scale = world_scale;
+			next.static_version = static_version;
+			next.miniature_version = miniature_version;
+
+			next.listener_position = glm::vec3(glm::inverse(camera_view) * glm::vec4{0,0,0,1});
+			next.listener_orientation = {cam_look.x, cam_look.y, -cam_look.z, -cam_norm.x, cam_norm.y, -cam_norm.z};
+
+			// Pages are assumed to cover equal stretches of the score
+			next.page = 0;
+			if (s.length() > 0.0)
+				next.page = static_cast<size_t>(s.position() / s.length() * pages.page_count());
+
+			snapshots.publish();
+		}
+	});
+
+	// The snapshot versions last drawn
+	size_t drawn_static_version = 0;
+	size_t drawn_miniature_version = 0;
+	// The hand as last latched, for the baton
+	glm::mat4 latched_hand(1.f);
+
+	bool first_frame = true;
+
+	while (window->refresh())
 	{
-		vr_compositor->WaitGetPoses(poses.data(), vr::k_unMaxTrackedDeviceCount, nullptr, 0);
+		{
+			TRACE_SCOPE("wait_frame");
+			runtime->wait_frame();
+		}
 
-		auto camera_view = glm::mat4(1.f);
-		if (poses[vr::k_unTrackedDeviceIndex_Hmd].bPoseIsValid)
-			camera_view = glm::inverse(make_mat4(poses[vr::k_unTrackedDeviceIndex_Hmd].mDeviceToAbsoluteTracking));
+		if (pose_record.is_open())
+		{
+			if (frame_count == 0)
+				record_start = std::chrono::steady_clock::now();
 
-		left_controller.update(poses);
-		right_controller.update(poses);
+			simulated_hmd::record(pose_record, seconds_since(record_start), *runtime);
+		}
 
-		hand_view = right_controller.get_model_matrix();
-		hand_pos = glm::vec3(hand_view * glm::vec4{ 0,0,0,1 });
+		// The simulation steps on these poses alongside the rest of this frame
+		{
+			std::lock_guard<std::mutex> lock(input_mutex);
+
+			latest_input.head = runtime->head();
+			latest_input.hands = {runtime->hand(xr_hand::left), runtime->hand(xr_hand::right)};
+			input_frame += 1;
+		}
+		input_ready.notify_one();
+
+		TRACE_SCOPE("frame");
+		profiler.begin_frame();
 
-		world_scale = glm::mat4(1.0f);
-		auto inverse_scale = glm::mat4(1.f);
-		if (select_mode) {
-			auto standp = stand->position();
-			standp.y += 0.85f;
+		// The newest finished step; held until the frame is submitted
+		auto& scene = snapshots.acquire();
 
-			world_scale = glm::scale(glm::rotate(glm::translate(standp), glm::radians(20.f), glm::vec3{1.f, 0.f, 0.f}), glm::vec3(1.f / scale_factor));
-			inverse_scale = glm::inverse(world_scale);
+		if (scene.static_version != drawn_static_version)
+		{
+			static_shadow_dirty = true;
+			drawn_static_version = scene.static_version;
 		}
 
-		if (selected) {
-			auto h = hand_pos * scale_factor + glm::mat3(hand_view) * glm::vec3(0.f, 0.f, -0.3f) * scale_factor;
-			auto p = selected->position();
+		if (scene.miniature_version != drawn_miniature_version)
+		{
+			miniature_dirty = true;
+			drawn_miniature_version = scene.miniature_version;
+		}
 
-			selected->position(glm::vec3{h.x, p.y, h.z});
+		// Poses come from this frame's latch rather than the snapshot, which may be a frame behind
+		auto camera_view = glm::mat4(1.f);
+		if (runtime->head().valid)
+			camera_view = glm::inverse(runtime->head().pose);
+
+		if (runtime->hand(xr_hand::right).valid)
+			latched_hand = runtime->hand(xr_hand::right).pose;
+
+		auto inverse_scale = glm::inverse(scene.world_scale);
+
+		auto left_proj = runtime->projection(xr_eye::left, 0.1f, 20.f);
+		auto left_view = glm::inverse(runtime->eye_to_head(xr_eye::left)) * camera_view;
+		auto right_proj = runtime->projection(xr_eye::right, 0.1f, 20.f);
+		auto right_view = glm::inverse(runtime->eye_to_head(xr_eye::right)) * camera_view;
+
+		auto cam_pos = glm::vec3(glm::inverse(camera_view) * glm::vec4{0,0,0,1});
+
+		// The listener follows the same snapshot as the picture, so sound and image agree
+		alListener3f(AL_POSITION, scene.listener_position.x, scene.listener_position.y, scene.listener_position.z);
+		alListener3f(AL_VELOCITY, 0.0f, 0.0f, 0.0f);
+		alListenerfv(AL_ORIENTATION, scene.listener_orientation.data());
+
+		pages.request(scene.page);
+		pages.update();
+
+		// Gather every instance drawn this frame
+		// The select mode miniature is drawn from a capture instead; see miniature_buffer
+		auto baton_transform = latched_hand * flip_model;
+
+		std::vector<model::instance> stage_instances = {{glm::mat4(1.f)}};
+		std::vector<model::instance> stand_instances;
+		std::vector<model::instance> baton_instances = {{baton_transform}};
+
+		if (!scene.select_mode) {
+			stand_instances.push_back({glm::translate(stand_position)});
 		} else {
-			current_bpm.update(hand_pos + glm::mat3(hand_view) * glm::vec3(0.f, 0.f, -0.3f), glfwGetTime());
-			// Inform channel streams
+			baton_instances.push_back({inverse_scale * baton_transform});
 		}
 
-		auto left_proj = make_mat4(hmd->GetProjectionMatrix(vr::EVREye::Eye_Left, 0.1f, 20.f));
-		auto left_view = glm::inverse(make_mat4(hmd->GetEyeToHeadTransform(vr::EVREye::Eye_Left))) * camera_view;
-		auto right_proj = make_mat4(hmd->GetProjectionMatrix(vr::EVREye::Eye_Right, 0.1f, 20.f));
-		auto right_view = glm::inverse(make_mat4(hmd->GetEyeToHeadTransform(vr::EVREye::Eye_Right))) * camera_view;
+		// Only the instrument being dragged can move; it casts a dynamic shadow
+		std::map<std::shared_ptr<model>, std::vector<model::instance>> ensemble, moving;
+		for (auto& member : scene.ensemble)
+		{
+			auto& group = member.moving ? moving[member.shape] : ensemble[member.shape];
+			group.push_back(member.instance);
+		}
 
-		auto cam_pos = glm::vec3(glm::inverse(camera_view) * glm::vec4{0,0,0,1});
-		auto cam_look = glm::mat3(camera_view) * camera_forward;
-		auto cam_norm = glm::mat3(camera_view) * camera_up;
+		stage->instances(stage_instances);
+		stand->instances(stand_instances);
+		baton->instances(baton_instances);
+		skybox->instances({{glm::mat4(1.f)}});
+
+		// Both eyes share a pass, so an instance is kept if either eye can see it
+		// The head is latched again after culling, so keep what lies just outside the views
+		std::vector<frustum> eye_frustums = {frustum(left_proj * left_view), frustum(right_proj * right_view)};
+		for (auto& f : eye_frustums)
+			for (auto& p : f.planes)
+				p.w += late_latch_margin;
+
+		// Every static object casts, but only the ones the eyes can see receive
+		// The baton and dragged instruments are left out, so moving them keeps the fit
+		std::vector<glm::vec4> casters;
+		auto add_casters = [&casters](const model& m, const std::vector<model::instance>& insts) {
+			for (auto& i : insts)
+				casters.push_back(m.bounding_sphere(i));
+		};
 
-		ALfloat o[] = {cam_look.x, cam_look.y, -cam_look.z, -cam_norm.x, cam_norm.y, -cam_norm.z};
+		add_casters(*stage, stage_instances);
+		add_casters(*stand, stand_instances);
+		for (auto& group : ensemble)
+			add_casters(*group.first, group.second);
 
-		alListener3f(AL_POSITION, cam_pos.x, cam_pos.y, cam_pos.z);
-		alListener3f(AL_VELOCITY, 0.0f, 0.0f, 0.0f);
-		alListenerfv(AL_ORIENTATION, o);
+		sphere_set caster_spheres;
+		for (auto& s : casters)
+			caster_spheres.push_back(glm::vec3(s), s.w);
 
-		glClearColor(0.f, 0.f, 0.f, 1.f);
+		std::vector<unsigned char> visible;
+		caster_spheres.cull(eye_frustums, visible);
+
+		std::vector<glm::vec4> receivers;
+		for (auto i = 0u; i != casters.size(); ++i)
+			if (visible[i])
+				receivers.push_back(casters[i]);
 
-		shadow_shader.bind();
+		// The cached static depth is only valid for the projection it was drawn with
+		auto fitted_proj = fit_shadow_projection(shadow_view, receivers, casters, shadow_size);
+		if (fitted_proj != shadow_proj)
 		{
-			shadow_buffer.bind();
-			glViewport(0, 0, 4096, 4096);
+			shadow_proj = fitted_proj;
+			static_shadow_dirty = true;
+		}
 
-			glClear(GL_DEPTH_BUFFER_BIT);
-			glCullFace(GL_FRONT);
+		const std::vector<frustum> shadow_frustum = {frustum(shadow_proj * shadow_view)};
 
-			shadow_shader.set_uniform("VP", shadow_proj * shadow_view);
-			stage->draw(shadow_shader, { "M" });
-			if (!select_mode)
-				stand->draw(shadow_shader, { "M" });
+		// Levels of detail follow each instance's size on screen, or in the shadow map
+		// The ortho projection maps 2 / proj[1][1] units onto the map
+		auto eye_scale = projection_scale(cam_pos, left_proj[1][1] * hmd_height * 0.5f);
+		auto shadow_scale = projection_scale::orthographic(shadow_proj[1][1] * shadow_size * 0.5f);
 
-			shadow_shader.set_uniform("M", hand_view * flip_model);
-			baton->draw(shadow_shader, {});
+		// The miniature is captured at full size, with the stand where it stands outside select mode
+		bool capture_miniature = scene.select_mode && miniature_dirty;
+		const std::vector<frustum> miniature_frustum = {frustum(miniature_constants.vp[0])};
+		auto miniature_scale = projection_scale::orthographic(miniature_proj[1][1] * miniature_size * 0.5f);
+		auto& miniature_stats = pass_stats[miniature_pass];
 
-			shadow_shader.set_uniform("VP", shadow_proj * shadow_view);
-			for (auto& inst : instruments)
-				inst.second.draw(shadow_shader, { "M" });
+		// Every model is drawn by a shadow pass and the eye pass
+		// Each pass adds its visible instances to the arena
+		arena.clear_instances();
+		draw_queue.clear();
 
-			if (select_mode) {
-				shadow_shader.set_uniform("VP", shadow_proj * shadow_view * world_scale);
+		auto& static_stats = pass_stats[static_shadow_pass];
+		auto& shadow_stats = pass_stats[shadow_pass];
 
-				stage->draw(shadow_shader, { "M" });
-				stand->draw(shadow_shader, { "M" });
+		for (auto* m : {stage.get(), stand.get()})
+		{
+			if (static_shadow_dirty)
+				m->queue(draw_queue, static_shadow_pass, shadow_shader, shadow_frustum, shadow_scale, static_stats);
+			m->queue(draw_queue, eye_pass, eye_shader, eye_frustums, eye_scale, pass_stats[eye_pass]);
+		}
 
-				for (auto& inst : instruments)
-					inst.second.draw(shadow_shader, { "M" });
+		baton->queue(draw_queue, shadow_pass, shadow_shader, shadow_frustum, shadow_scale, shadow_stats);
+		baton->queue(draw_queue, eye_pass, eye_shader, eye_frustums, eye_scale, pass_stats[eye_pass]);
 
-				shadow_shader.set_uniform("M", hand_view * flip_model);
-				shadow_shader.set_uniform("VP", shadow_proj * shadow_view * inverse_scale);
-				baton->draw(shadow_shader, {});
-			}
+		// Models shared by both groups are queued once with each set of instances
+		// Only the moving group can hold the selected instrument, so only it reads the tint
+		for (auto& group : moving)
+		{
+			group.first->instances(group.second);
+			group.first->queue(draw_queue, shadow_pass, shadow_shader, shadow_frustum, shadow_scale, shadow_stats);
+			group.first->queue(draw_queue, eye_pass, eye_tint_shader, eye_frustums, eye_scale, pass_stats[eye_pass]);
+			if (capture_miniature)
+				group.first->queue(draw_queue, miniature_pass, miniature_tint_shader, miniature_frustum, miniature_scale, miniature_stats);
+		}
 
-			glCullFace(GL_BACK);
+		for (auto& group : ensemble)
+		{
+			group.first->instances(group.second);
+			if (static_shadow_dirty)
+				group.first->queue(draw_queue, static_shadow_pass, shadow_shader, shadow_frustum, shadow_scale, static_stats);
+			group.first->queue(draw_queue, eye_pass, eye_shader, eye_frustums, eye_scale, pass_stats[eye_pass]);
+			if (capture_miniature)
+				group.first->queue(draw_queue, miniature_pass, miniature_shader, miniature_frustum, miniature_scale, miniature_stats);
+		}
+
+		if (capture_miniature)
+		{
+			stage->queue(draw_queue, miniature_pass, miniature_shader, miniature_frustum, miniature_scale, miniature_stats);
 
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
-			glViewport(0.f, 0.f, window.framebuffer_size().x, window.framebuffer_size().y);
+			stand->instances({{glm::translate(stand_position)}});
+			stand->queue(draw_queue, miniature_pass, miniature_shader, miniature_frustum, miniature_scale, miniature_stats);
 		}
 
-		auto render_view = [&](const glm::mat4& proj, const glm::mat4& view)
+		// The skybox surrounds the viewer, so it is never culled or simplified
+		skybox->queue(draw_queue, sky_pass, skybox_shader, {}, {}, pass_stats[sky_pass]);
+
+		arena.flush();
+
+		// Every program reads these blocks, so each is only written once
+		// Keep the bias at a constant 1.5cm in world space; ortho z maps far - near onto 2
+		frame_block frame{shadow_proj * shadow_view, 0.015f * std::abs(shadow_proj[2][2]) * 0.5f};
+		frame_uniforms.update(frame);
+		frame_uniforms.bind_base(frame_binding);
+
+		view_block shadow_constants{};
+		shadow_constants.vp[0] = frame.shadow_vp;
+		shadow_uniforms.update(shadow_constants);
+
+		// Latch the head once more; only the views change, the frame's work is already queued
+		runtime->latch();
+		if (runtime->head().valid)
 		{
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			camera_view = glm::inverse(runtime->head().pose);
+			left_view = glm::inverse(runtime->eye_to_head(xr_eye::left)) * camera_view;
+			right_view = glm::inverse(runtime->eye_to_head(xr_eye::right)) * camera_view;
+		}
 
-			skybox_shader.bind();
-			{
-				glDepthMask(GL_FALSE);
+		// Both eyes are submitted together, each instance is drawn once per eye
+		view_block eye_constants{};
+		eye_constants.vp[0] = left_proj * left_view;
+		eye_constants.vp[1] = right_proj * right_view;
+		eye_constants.skybox_vp[0] = left_proj * glm::mat4(glm::mat3(left_view));
+		eye_constants.skybox_vp[1] = right_proj * glm::mat4(glm::mat3(right_view));
+		eye_uniforms.update(eye_constants);
 
-				skybox_shader.set_uniform("VP", proj * glm::mat4(glm::mat3(view)));
-				skybox_texture.bind_to(0);
+		glClearColor(0.f, 0.f, 0.f, 1.f);
 
-				skybox->draw(skybox_shader, {});
+		{
+			TRACE_SCOPE("shadow pass");
+			hs::gpu_profiler::scope profile(profiler, "shadow", hs::gpu_profiler::elapsed | hs::gpu_profiler::primitives);
 
-				glDepthMask(GL_TRUE);
-			}
+			shadow_uniforms.bind_base(view_binding);
+			glViewport(0, 0, shadow_size, shadow_size);
+			glCullFace(GL_FRONT);
 
-			shader.bind();
+			// The light never moves, so static casters are only redrawn when they change
+			if (static_shadow_dirty)
 			{
-				shader.set_uniform("VP", proj * view);
-				shader.set_uniform("ShadowVP", shadow_proj * shadow_view);
-				shadow_buffer.get_depth().bind_to(0);
+				static_shadow_buffer.bind();
+				glClear(GL_DEPTH_BUFFER_BIT);
 
-				stage->draw(shader, { "M", "Color" });
-				if (!select_mode)
-					stand->draw(shader, { "M", "Color" });
+				draw_queue.submit(static_shadow_pass);
+				static_shadow_dirty = false;
+			}
 
-				shader.set_uniform("M", hand_view * flip_model);
-				baton->draw(shader, { "Color" });
+			// Start from the cached depth and add the dynamic casters on top
+			glCopyImageSubData(static_shadow_buffer.get_depth().name(), GL_TEXTURE_2D, 0, 0, 0, 0,
+			                   shadow_buffer.get_depth().name(), GL_TEXTURE_2D, 0, 0, 0, 0,
+			                   shadow_size, shadow_size, 1);
 
-				shader.set_uniform("VP", proj * view);
-				shader.set_uniform("ShadowVP", shadow_proj * shadow_view);
-				for (auto& inst : instruments)
-					inst.second.draw(shader, { "M", "Color" });
+			shadow_buffer.bind();
+			draw_queue.submit(shadow_pass);
 
-				if (select_mode) {
-					shader.set_uniform("VP", proj * view * world_scale);
-					shader.set_uniform("ShadowVP", shadow_proj * shadow_view * world_scale);
+			glCullFace(GL_BACK);
 
-					stage->draw(shader, { "M", "Color" });
-					stand->draw(shader, { "M", "Color" });
+			screen_buffer.bind();
+			glViewport(0.f, 0.f, window->framebuffer_size().x, window->framebuffer_size().y);
+		}
 
-					for (auto& inst : instruments)
-						inst.second.draw(shader, { "M", "Color" });
+		if (capture_miniature)
+		{
+			hs::gpu_profiler::scope profile(profiler, "miniature");
 
-					shader.set_uniform("M", hand_view * flip_model);
-					shader.set_uniform("VP", proj * view * inverse_scale);
-					shader.set_uniform("ShadowVP", shadow_proj * shadow_view * inverse_scale);
-					baton->draw(shader, { "Color" });
-				}
-			}
+			miniature_buffer.bind();
+			miniature_uniforms.bind_base(view_binding);
+			glViewport(0, 0, miniature_size, miniature_size);
+
+			// Zero alpha marks the texels the impostor leaves out
+			glClearColor(0.f, 0.f, 0.f, 0.f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glClearColor(0.f, 0.f, 0.f, 1.f);
+
+			shadow_buffer.get_depth().bind_to(shadow_unit);
+			shadow_sampler.bind_to(shadow_unit);
+
+			draw_queue.submit(miniature_pass);
+			miniature_buffer.get_color(0).generate_mipmaps();
+			miniature_dirty = false;
+		}
+
+		glViewport(0.f, 0.f, hmd_width * 2, hmd_height);
+		eye_buffer.bind();
+		eye_uniforms.bind_base(view_binding);
+		{
+			TRACE_SCOPE("eye pass");
+			glEnable(GL_CLIP_DISTANCE0);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			glDepthMask(GL_FALSE);
+			skybox_texture.bind_to(0);
+
+			profiler.begin("sky");
+			draw_queue.submit(sky_pass);
+			profiler.end();
+
+			glDepthMask(GL_TRUE);
+			shadow_buffer.get_depth().bind_to(shadow_unit);
+			shadow_sampler.bind_to(shadow_unit);
+
+			// Both eyes are a single pass
+			profiler.begin("eye", hs::gpu_profiler::elapsed | hs::gpu_profiler::primitives | hs::gpu_profiler::samples);
+			draw_queue.submit(eye_pass);
+			profiler.end();
 
 			page_shader.bind();
 			{
-				auto standp = stand->position();
+				hs::gpu_profiler::scope profile(profiler, "page");
+
+				auto standp = stand_position;
 				standp.y += 0.85f;
 
+				// Like the miniature instances, the page is placed under world_scale
 				auto m = glm::rotate(glm::translate(standp), glm::radians(20.f), glm::vec3{1.f, 0.f, 0.f});
-				page_shader.set_uniform("M", m);
-				page_shader.set_uniform("VP", proj * view * world_scale);
-				page_shader.set_uniform("ShadowVP", shadow_proj * shadow_view * world_scale);
+				page_shader.set_uniform(page_shader_m, scene.world_scale * m);
 
-				page_texture->bind_to(0);
-				shadow_buffer.get_depth().bind_to(1);
+				pages.get_texture().bind_to(0);
+				page_shader.set_uniform(page_shader_layer, pages.layer());
 
 				page.bind();
-				glDrawArrays(GL_TRIANGLES, 0, 6);
+				glDrawArraysInstanced(GL_TRIANGLES, 0, 6, model::view_count(page_shader));
 			}
-		};
 
-		glViewport(0.f, 0.f, hmd_width, hmd_height);
-		left_eye_buffer.bind();
-		render_view(left_proj, left_view);
-		right_eye_buffer.bind();
-		render_view(right_proj, right_view);
+			if (scene.select_mode)
+			{
+				hs::gpu_profiler::scope profile(profiler, "impostor");
+
+				impostor_shader.bind();
+				impostor_shader.set_uniform(impostor_shader_m, scene.world_scale * miniature_placement);
+
+				miniature_buffer.get_color(0).bind_to(0);
+
+				quad.bind();
+				glDrawArraysInstanced(GL_TRIANGLES, 0, 6, model::view_count(impostor_shader));
+			}
+
+			glDisable(GL_CLIP_DISTANCE0);
+		}
 
 		glViewport(0, 0, hmd_width/2.f, hmd_height/2.f);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		screen_buffer.bind();
 
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		quad_shader.bind();
 		{
-			left_eye_buffer.get_color(0).bind_to(0);
+			hs::gpu_profiler::scope profile(profiler, "mirror");
+
+			eye_buffer.get_color(0).bind_to(0);
 
 			quad.bind();
 			glDrawArrays(GL_TRIANGLES, 0, 6);
 		}
 
-		vr::Texture_t left_info{(void*)left_eye_buffer.get_color(0).name(), vr::TextureType_OpenGL, vr::ColorSpace_Gamma};
-		vr::Texture_t right_info{(void*)right_eye_buffer.get_color(0).name(), vr::TextureType_OpenGL, vr::ColorSpace_Gamma};
+		runtime->submit(eye_buffer.get_color(0).name());
+		snapshots.release();
 
-		vr_compositor->Submit(vr::EVREye::Eye_Left, &left_info);
-		vr_compositor->Submit(vr::EVREye::Eye_Right, &right_info);
+		// The compositor is free to change any GL state while submitting
+		context.get_state().invalidate();
+		context.end_frame();
+		frame_count += 1;
+
+		if (first_frame) {
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - launch_time;
+			std::cout << "Time to first frame: " << elapsed.count() << "ms" << std::endl;
+
+			first_frame = false;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(input_mutex);
+		simulating = false;
+	}
+	input_ready.notify_one();
+	simulation.join();
+
+	if (frame_count) {
+		auto& stats = context.get_state().stats();
+		std::cout << "GL binds per frame: " << stats.issued / frame_count << " issued, "
+		          << stats.elided / frame_count << " elided" << std::endl;
+		std::cout << "Live GL objects: " << context.live_objects(GL_BUFFER) << " buffers, "
+		          << context.live_objects(GL_TEXTURE) << " textures, " << context.live_objects(GL_FRAMEBUFFER) << " framebuffers, "
+		          << context.live_objects(GL_VERTEX_ARRAY) << " vertex arrays, " << context.live_objects(GL_PROGRAM) << " programs, "
+		          << context.live_objects(GL_SAMPLER) << " samplers, " << context.pending_deletions() << " waiting to be deleted" << std::endl;
+		std::cout << "Frames waiting on the GPU to write instances: " << arena.stalls()
+		          << ", draw commands: " << draw_queue.stalls() << std::endl;
+		std::cout << "Frames showing an old page while the next was loading: " << pages.misses() << std::endl;
+
+		runtime->report(std::cout);
+
+		std::cout << "GPU passes over the last " << hs::gpu_profiler::window << " frames:" << std::endl;
+		profiler.report(std::cout);
+
+		std::ofstream profile_csv("profile.csv");
+		profiler.write_csv(profile_csv);
+
+		std::ofstream trace_json("trace.json");
+		trace::write_json(trace_json);
+
+		const char* pass_names[] = {"static shadow", "shadow", "miniature", "sky", "eye"};
+		for (auto i = 0u; i != pass_stats.size(); ++i) {
+			std::cout << "Objects per frame in " << pass_names[i] << " pass: " << pass_stats[i].drawn / frame_count << " drawn, "
+			          << pass_stats[i].culled / frame_count << " culled, " << pass_stats[i].triangles / frame_count << " triangles" << std::endl;
+		}
 	}
 
 	should_run = false;
@@ -586,6 +1299,5 @@ int main(int argc, char** argv)
 	// Stop playback
 	s.stop();
 
-	vr::VR_Shutdown();
 	return 0;
 }
\ No newline at end of file
@@ -1,5 +1,9 @@
 #include "model.hpp"
 
+#include "geometry_arena.hpp"
+#include "simplify.hpp"
+
+#include <algorithm>
 #include <map>
 #include <glm/gtc/matrix_transform.hpp>
 #include <string>
@@ -7,43 +11,151 @@
 // Static map in order to only import a model once
 std::unordered_map<std::string, std::shared_ptr<model>> model::g_model_cache = {};
 
-model::model(hs::context& con, const std::string& modelPath)
-: m_position{}
+model::model(geometry_arena& arena, const std::string& modelPath)
+: model(arena, import(modelPath))
 {
-	helper::assimp_model mod(modelPath);
-	auto mshs = mod.get_meshes<vertex>();
-	auto mats = mod.get_materials();
+}
 
-	for (auto& msh : mshs)
-		m_meshes.emplace_back(con, msh.data.vertices, mats[msh.material_index]);
+model::model(geometry_arena& arena, const std::vector<mesh_data>& meshes)
+: m_arena{arena}, m_bounds{}, m_lod_count{1}
+{
+	for (auto& msh : meshes)
+	{
+		auto r = arena.allocate(msh.vertices, msh.lods.front());
+		auto b = bounds::from_vertices(msh.vertices);
+
+		std::vector<mesh::lod> lods = {{r.first_index, r.count}};
+		for (auto i = 1u; i < msh.lods.size(); ++i)
+		{
+			auto l = arena.allocate_indices(r, msh.lods[i]);
+			lods.push_back({l.first_index, l.count});
+		}
+
+		m_lod_count = std::max(m_lod_count, lods.size());
+
+		m_bounds = (m_meshes.empty()) ? b : bounds::merge(m_bounds, b);
+		m_meshes.push_back({r.base_vertex, std::move(lods), b});
+	}
+
+	m_kept.resize(m_lod_count);
 }
 
-void model::draw(hs::shader& shad, const std::set<std::string>& unis, const glm::mat4& M) 
+model::bounds model::bounds::from_vertices(const std::vector<vertex>& verts)
 {
-	shad.bind();
+	bounds b{};
+	if (verts.empty())
+		return b;
 
-	for (auto& msh : m_meshes)
+	b.min = b.max = verts.front().position;
+	for (auto& v : verts)
 	{
-		if (unis.count("M"))
-			shad.set_uniform("M", glm::translate(glm::mat4(1.f), m_position) * M);
-		if (unis.count("Color"))
-			shad.set_uniform("Color", msh.material.color);
-		if (unis.count("Selected"))
-			shad.set_uniform("Selected", glm::vec3(0.3f, 0.f, 0.f));
-
-		msh.state.bind();
-		glDrawArrays(GL_TRIANGLES, 0, msh.vertices.size());
-
-		if (unis.count("Selected"))
-			shad.set_uniform("Selected", glm::vec3(0.f, 0.f, 0.f));
+		b.min = glm::min(b.min, v.position);
+		b.max = glm::max(b.max, v.position);
 	}
+
+	b.center = (b.min + b.max) * 0.5f;
+	b.radius = glm::length(b.max - b.center);
+
+	return b;
 }
 
-std::shared_ptr<model> model::load_model(hs::context& contex, const std::string& path)
+model::bounds model::bounds::merge(const bounds& a, const bounds& b)
+{
+	bounds m{};
+	m.min = glm::min(a.min, b.min);
+	m.max = glm::max(a.max, b.max);
+
+	m.center = (m.min + m.max) * 0.5f;
+	m.radius = glm::length(m.max - m.center);
+
+	return m;
+}
+
+void model::instances(const std::vector<instance>& insts)
+{
+	m_instances = insts;
+
+	m_spheres.clear();
+	for (auto& i : m_instances)
+	{
+		auto s = bounding_sphere(i);
+		m_spheres.push_back(glm::vec3(s), s.w);
+	}
+}
+
+glm::vec4 model::bounding_sphere(const instance& i) const
+{
+	// Instance transforms may scale (eg, the select mode miniature), so the radius
+	// grows with the largest axis
+	auto& t = i.transform;
+	auto scale = std::max({glm::length(glm::vec3(t[0])), glm::length(glm::vec3(t[1])), glm::length(glm::vec3(t[2]))});
+
+	return glm::vec4(glm::vec3(t * glm::vec4(m_bounds.center, 1.f)), m_bounds.radius * scale);
+}
+
+void model::queue(hs::render_queue& q, size_t pass, hs::shader& shad,
+                  const std::vector<frustum>& view, const projection_scale& scale, cull_stats& stats)
+{
+	if (m_instances.empty())
+		return;
+
+	m_spheres.cull(view, m_visible);
+
+	// Group the visible instances by level of detail
+	for (auto& k : m_kept)
+		k.clear();
+
+	size_t drawn = 0;
+
+	for (auto i = 0u; i != m_instances.size(); ++i)
+	{
+		if (!m_visible[i])
+			continue;
+
+		auto size = scale.size(bounding_sphere(m_instances[i]));
+		auto threshold = full_detail_size;
+
+		size_t level = 0;
+		while (size < threshold && level + 1 < m_lod_count)
+		{
+			threshold *= 0.5f;
+			level += 1;
+		}
+
+		m_kept[level].push_back(m_instances[i]);
+		drawn += 1;
+	}
+
+	stats.drawn += drawn;
+	stats.culled += m_instances.size() - drawn;
+
+	auto views = view_count(shad);
+	auto& state = m_arena.get().get_state(views);
+	for (auto level = 0u; level != m_kept.size(); ++level)
+	{
+		if (m_kept[level].empty())
+			continue;
+
+		// Each pass sees a different set of instances, so each gets its own range
+		auto base_instance = m_arena.get().push_instances(m_kept[level]);
+		auto instances = static_cast<GLsizei>(m_kept[level].size() * views);
+
+		for (auto& msh : m_meshes)
+		{
+			// Meshes that could not be simplified as far use their coarsest level
+			auto& lod = msh.lods[std::min<size_t>(level, msh.lods.size() - 1)];
+
+			q.push({pass, &shad, &state, GL_TRIANGLES, lod.first_index, lod.count, msh.base_vertex, base_instance, instances});
+			stats.triangles += static_cast<size_t>(lod.count / 3) * instances;
+		}
+	}
+}
+
+std::shared_ptr<model> model::load_model(geometry_arena& arena, const std::string& path)
 {
 	std::shared_ptr<model> m;
 	if (g_model_cache.count(path) == 0) {
-		m = std::make_shared<model>(contex, path);
+		m = std::make_shared<model>(arena, path);
 		g_model_cache.emplace(path, m);
 	} else {
 		m = g_model_cache.at(path);
@@ -54,4 +166,44 @@ std::shared_ptr<model> model::load_model(hs::context& contex, const std::string&
 
 std::shared_ptr<model> model::get_model(const std::string& path) {
 	return g_model_cache.at(path);
+}
+
+std::vector<model::mesh_data> model::import(const std::string& path)
+{
+	helper::assimp_model mod(path);
+	auto mshs = mod.get_meshes<vertex>();
+	auto mats = mod.get_materials();
+
+	std::vector<mesh_data> meshes;
+	meshes.reserve(mshs.size());
+
+	for (auto& msh : mshs)
+	{
+		auto& mat = mats[msh.material_index];
+		for (auto& v : msh.data.vertices)
+			v.color = mat.color;
+
+		std::vector<glm::vec3> positions;
+		positions.reserve(msh.data.vertices.size());
+		for (auto& v : msh.data.vertices)
+			positions.push_back(v.position);
+
+		// Each level aims for half the triangles of the one before it
+		std::vector<std::vector<GLuint>> lods = {std::move(msh.data.indices)};
+		while (lods.size() < max_lods)
+		{
+			auto& prev = lods.back();
+			auto next = simplify(positions, prev, (prev.size() / 6) * 3);
+
+			// Stop once the mesh can no longer be reduced by much
+			if (next.empty() || next.size() * 4 > prev.size() * 3)
+				break;
+
+			lods.push_back(std::move(next));
+		}
+
+		meshes.push_back({std::move(msh.data.vertices), std::move(lods), mat});
+	}
+
+	return meshes;
 }
\ No newline at end of file
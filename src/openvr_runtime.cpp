@@ -0,0 +1,176 @@
+#include <openvr_runtime.hpp>
+
+#include <cassert>
+
+namespace
+{
+	glm::mat4 make_mat4(const vr::HmdMatrix34_t& mat)
+	{
+		return glm::mat4{
+			mat.m[0][0], mat.m[1][0], mat.m[2][0], 0.0,
+			mat.m[0][1], mat.m[1][1], mat.m[2][1], 0.0,
+			mat.m[0][2], mat.m[1][2], mat.m[2][2], 0.0,
+			mat.m[0][3], mat.m[1][3], mat.m[2][3], 1.0f
+		};
+	}
+
+	glm::mat4 make_mat4(const vr::HmdMatrix44_t& mat)
+	{
+		return glm::mat4{
+			mat.m[0][0], mat.m[1][0], mat.m[2][0], mat.m[3][0],
+			mat.m[0][1], mat.m[1][1], mat.m[2][1], mat.m[3][1],
+			mat.m[0][2], mat.m[1][2], mat.m[2][2], mat.m[3][2],
+			mat.m[0][3], mat.m[1][3], mat.m[2][3], mat.m[3][3]
+		};
+	}
+
+	vr::EVREye make_eye(xr_eye e)
+	{
+		return (e == xr_eye::left) ? vr::EVREye::Eye_Left : vr::EVREye::Eye_Right;
+	}
+
+	void update_device(xr_device& d, const vr::TrackedDevicePose_t& pose)
+	{
+		d.valid = pose.bPoseIsValid;
+		if (d.valid)
+			d.pose = make_mat4(pose.mDeviceToAbsoluteTracking);
+	}
+}
+
+openvr_runtime::openvr_runtime()
+	: m_poses(vr::k_unMaxTrackedDeviceCount), m_hand_index{vr::k_unTrackedDeviceIndexInvalid, vr::k_unTrackedDeviceIndexInvalid}
+{
+	vr::EVRInitError error;
+	m_system = vr::VR_Init(&error, vr::EVRApplicationType::VRApplication_Scene);
+	assert(error == vr::VRInitError_None);
+
+	m_compositor = vr::VRCompositor();
+	assert(m_compositor);
+}
+
+openvr_runtime::~openvr_runtime()
+{
+	vr::VR_Shutdown();
+}
+
+glm::uvec2 openvr_runtime::render_size() const
+{
+	std::uint32_t w, h;
+	m_system->GetRecommendedRenderTargetSize(&w, &h);
+
+	return {w, h};
+}
+
+void openvr_runtime::wait_frame()
+{
+	m_compositor->WaitGetPoses(m_poses.data(), vr::k_unMaxTrackedDeviceCount, nullptr, 0);
+
+	update_device(m_head, m_poses[vr::k_unTrackedDeviceIndex_Hmd]);
+	m_head_tracking = m_poses[vr::k_unTrackedDeviceIndex_Hmd].mDeviceToAbsoluteTracking;
+
+	for (auto h : {xr_hand::left, xr_hand::right})
+	{
+		find_hand(h);
+
+		auto i = static_cast<size_t>(h);
+		auto index = m_hand_index[i];
+		if (index == vr::k_unTrackedDeviceIndexInvalid || !m_system->IsTrackedDeviceConnected(index))
+		{
+			m_hands[i].valid = false;
+			continue;
+		}
+
+		update_device(m_hands[i], m_poses[index]);
+
+		vr::VRControllerState_t state;
+		m_system->GetControllerState(index, &state, sizeof(state));
+
+		// A touch counts as a press, as the controllers always have
+		auto down = state.ulButtonPressed | state.ulButtonTouched;
+
+		m_hands[i].buttons = 0;
+		if (down & vr::ButtonMaskFromId(vr::EVRButtonId::k_EButton_SteamVR_Trigger))
+			m_hands[i].buttons |= xr_trigger;
+		if (down & vr::ButtonMaskFromId(vr::EVRButtonId::k_EButton_ApplicationMenu))
+			m_hands[i].buttons |= xr_menu;
+	}
+}
+
+void openvr_runtime::latch()
+{
+	float since_vsync;
+	std::uint64_t frame;
+	if (!m_system->GetTimeSinceLastVsync(&since_vsync, &frame))
+		return;
+
+	auto frequency = m_system->GetFloatTrackedDeviceProperty(vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DisplayFrequency_Float);
+	auto to_photons = m_system->GetFloatTrackedDeviceProperty(vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_SecondsFromVsyncToPhotons_Float);
+	if (frequency <= 0.f)
+		return;
+
+	// The frame is shown from the next vsync on
+	auto predicted = 1.f / frequency - since_vsync + to_photons;
+
+	vr::TrackedDevicePose_t head;
+	m_system->GetDeviceToAbsoluteTrackingPose(m_compositor->GetTrackingSpace(), predicted, &head, 1);
+
+	if (head.bPoseIsValid)
+	{
+		update_device(m_head, head);
+		m_head_tracking = head.mDeviceToAbsoluteTracking;
+	}
+}
+
+void openvr_runtime::submit(GLuint texture)
+{
+	const vr::VRTextureBounds_t left_bounds{0.f, 0.f, 0.5f, 1.f};
+	const vr::VRTextureBounds_t right_bounds{0.5f, 0.f, 1.f, 1.f};
+
+	vr::VRTextureWithPose_t info;
+	info.handle = (void*)(uintptr_t)texture;
+	info.eType = vr::TextureType_OpenGL;
+	info.eColorSpace = vr::ColorSpace_Gamma;
+	info.mDeviceToAbsoluteTracking = m_head_tracking;
+
+	m_compositor->Submit(vr::EVREye::Eye_Left, &info, &left_bounds, vr::Submit_TextureWithPose);
+	m_compositor->Submit(vr::EVREye::Eye_Right, &info, &right_bounds, vr::Submit_TextureWithPose);
+}
+
+glm::mat4 openvr_runtime::projection(xr_eye e, float near_plane, float far_plane) const
+{
+	return make_mat4(m_system->GetProjectionMatrix(make_eye(e), near_plane, far_plane));
+}
+
+glm::mat4 openvr_runtime::eye_to_head(xr_eye e) const
+{
+	return make_mat4(m_system->GetEyeToHeadTransform(make_eye(e)));
+}
+
+void openvr_runtime::report(std::ostream& out) const
+{
+	vr::Compositor_CumulativeStats stats{};
+	m_compositor->GetCumulativeStats(&stats, sizeof(stats));
+
+	out << "Compositor: " << stats.m_nNumFramePresents << " frames presented, "
+	    << stats.m_nNumDroppedFrames << " dropped, " << stats.m_nNumReprojectedFrames << " reprojected" << std::endl;
+}
+
+void openvr_runtime::find_hand(xr_hand h)
+{
+	auto& index = m_hand_index[static_cast<size_t>(h)];
+	if (index != vr::k_unTrackedDeviceIndexInvalid)
+		return;
+
+	auto role = (h == xr_hand::left) ? vr::TrackedControllerRole_LeftHand : vr::TrackedControllerRole_RightHand;
+	for (auto i = vr::k_unTrackedDeviceIndex_Hmd + 1; i < vr::k_unMaxTrackedDeviceCount; ++i)
+	{
+		if (m_system->GetTrackedDeviceClass(i) != vr::ETrackedDeviceClass::TrackedDeviceClass_Controller)
+			continue;
+
+		if (m_system->GetControllerRoleForTrackedDeviceIndex(i) == role)
+		{
+			index = i;
+			return;
+		}
+	}
+}
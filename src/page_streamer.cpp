@@ -0,0 +1,276 @@
+#include <page_streamer.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+
+namespace
+{
+	// Size of a mipmap level; no side is ever smaller than a pixel
+	glm::uvec2 level_size(const glm::uvec2& size, size_t level)
+	{
+		return glm::uvec2(std::max(size.x >> level, 1u), std::max(size.y >> level, 1u));
+	}
+
+	size_t level_count(const glm::uvec2& size)
+	{
+		size_t levels = 1;
+		while ((size.x >> levels) || (size.y >> levels))
+			levels += 1;
+
+		return levels;
+	}
+
+	// Box filter a decoded RGBA page down to every mipmap level
+	page_streamer::mip_chain build_levels(const helper::stb_image& image)
+	{
+		assert(image.data && image.component_size == 4);
+
+		page_streamer::mip_chain levels;
+		levels.emplace_back(image.data, image.data + image.data_size());
+
+		auto size = image.size();
+		auto count = level_count(size);
+		for (auto l = 1u; l != count; ++l)
+		{
+			auto src = level_size(size, l - 1);
+			auto dst = level_size(size, l);
+
+			auto& from = levels.back();
+			std::vector<unsigned char> to(dst.x * dst.y * 4);
+
+			// Odd sides fold their last texel in twice
+			for (auto y = 0u; y != dst.y; ++y)
+			{
+				unsigned y0 = std::min(y * 2, src.y - 1), y1 = std::min(y * 2 + 1, src.y - 1);
+				for (auto x = 0u; x != dst.x; ++x)
+				{
+					unsigned x0 = std::min(x * 2, src.x - 1), x1 = std::min(x * 2 + 1, src.x - 1);
+					for (auto c = 0u; c != 4; ++c)
+					{
+						unsigned sum = from[(y0 * src.x + x0) * 4 + c] + from[(y0 * src.x + x1) * 4 + c]
+						             + from[(y1 * src.x + x0) * 4 + c] + from[(y1 * src.x + x1) * 4 + c];
+
+						to[(y * dst.x + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+					}
+				}
+			}
+
+			levels.push_back(std::move(to));
+		}
+
+		return levels;
+	}
+
+	// An empty chain if the page cannot be read, or is not the size of the first
+	page_streamer::mip_chain decode(const std::string& path, glm::uvec2 size)
+	{
+		helper::stb_image image(path, GL_RGBA);
+		if (!image.data || image.size() != size)
+		{
+			std::clog << "page_streamer: skipping " << path << (image.data ? ", which is not the size of the first page" : ", which could not be decoded") << std::endl;
+			return {};
+		}
+
+		return build_levels(image);
+	}
+}
+
+page_streamer::page_streamer(hs::context& c, loader& assets, const std::vector<std::string>& paths,
+                             std::future<helper::stb_image> first, size_t slots)
+: m_loader{assets}, m_paths{paths}, m_size{}, m_levels{1},
+  m_texture{c, GL_TEXTURE_2D_ARRAY, glm::uvec3(1, 1, slots)},
+  m_staging{hs::stream_buffer::empty<unsigned char>(c, GL_PIXEL_UNPACK_BUFFER, upload_budget)},
+  m_slots(slots, no_page), m_requested{0}, m_shown{0}, m_misses{0}
+{
+	assert(!m_paths.empty() && slots >= 2);
+
+	// The first page decides the size of every layer
+	// Without it, the layers hold a single white texel, and every other page is skipped
+	auto image = first.get();
+	m_size = image.data ? image.size() : glm::uvec2(1, 1);
+	assert(m_size.x * 4 <= upload_budget);
+
+	if (!image.data)
+		std::clog << "page_streamer: " << m_paths.front() << " could not be decoded, showing a blank page" << std::endl;
+
+	m_levels = level_count(m_size);
+	m_texture.resize(glm::uvec3(m_size, slots));
+	m_texture.allocate(GL_RGBA8, m_levels);
+	m_texture.set_filter(GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+
+	auto levels = image.data ? build_levels(image) : mip_chain{{255, 255, 255, 255}};
+
+	// Nothing is drawn yet, so the first page goes up all at once
+	m_upload = std::make_unique<upload>(upload{0, 0, std::move(levels), 0, 0});
+	while (m_upload)
+	{
+		m_staging.next_region();
+		continue_upload();
+	}
+
+	update();
+}
+
+void page_streamer::request(size_t page)
+{
+	m_requested = std::min(page, m_paths.size() - 1);
+}
+
+void page_streamer::update()
+{
+	auto pages = wanted();
+	auto is_wanted = [&pages](size_t p) { return std::find(pages.begin(), pages.end(), p) != pages.end(); };
+
+	// Collect finished decodes; pages no longer wanted are dropped
+	for (auto it = m_decoding.begin(); it != m_decoding.end();)
+	{
+		if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++it;
+			continue;
+		}
+
+		// A page that failed is never queued again, so the page before it stays up
+		auto levels = it->second.get();
+		if (levels.empty())
+			m_failed.insert(it->first);
+		else if (is_wanted(it->first))
+			m_decoded.emplace(it->first, std::move(levels));
+
+		it = m_decoding.erase(it);
+	}
+
+	for (auto it = m_decoded.begin(); it != m_decoded.end();)
+		it = is_wanted(it->first) ? std::next(it) : m_decoded.erase(it);
+
+	// Queue decodes for wanted pages that are not on their way yet
+	for (auto p : pages)
+	{
+		bool uploading = (m_upload && m_upload->page == p);
+		if (find_slot(p) != m_slots.size() || uploading || m_decoding.count(p) || m_decoded.count(p) || m_failed.count(p))
+			continue;
+
+		auto path = m_paths[p];
+		auto size = m_size;
+		m_decoding.emplace(p, m_loader.get().queue_task([path, size]() { return decode(path, size); }));
+	}
+
+	if (!m_upload)
+		start_upload();
+
+	if (m_upload)
+	{
+		m_staging.next_region();
+		continue_upload();
+	}
+
+	// Never wait on a page turn; keep the old page up until the new one is complete
+	if (find_slot(m_requested) != m_slots.size())
+		m_shown = m_requested;
+	else
+		m_misses += 1;
+}
+
+GLint page_streamer::layer() const
+{
+	auto slot = find_slot(m_shown);
+	assert(slot != m_slots.size());
+
+	return static_cast<GLint>(slot);
+}
+
+std::vector<size_t> page_streamer::wanted() const
+{
+	std::vector<size_t> pages;
+	for (auto p = m_requested; p != m_paths.size() && pages.size() + 1 < m_slots.size(); ++p)
+		pages.push_back(p);
+
+	if (m_requested > 0)
+		pages.push_back(m_requested - 1);
+
+	return pages;
+}
+
+size_t page_streamer::find_slot(size_t page) const
+{
+	return static_cast<size_t>(std::find(m_slots.begin(), m_slots.end(), page) - m_slots.begin());
+}
+
+void page_streamer::start_upload()
+{
+	auto pages = wanted();
+
+	auto next = std::find_if(pages.begin(), pages.end(), [this](size_t p) { return m_decoded.count(p) != 0; });
+	if (next == pages.end())
+		return;
+
+	// Give up an empty layer first, then one holding a page that is no longer wanted
+	// The page being shown is never replaced
+	auto slot = find_slot(no_page);
+	for (auto s = 0u; slot == m_slots.size() && s != m_slots.size(); ++s)
+	{
+		auto held = m_slots[s];
+		if (held != m_shown && std::find(pages.begin(), pages.end(), held) == pages.end())
+			slot = s;
+	}
+
+	if (slot == m_slots.size())
+		return;
+
+	auto page = *next;
+	m_slots[slot] = no_page;
+
+	m_upload = std::make_unique<upload>(upload{page, slot, std::move(m_decoded.at(page)), 0, 0});
+	m_decoded.erase(page);
+}
+
+void page_streamer::continue_upload()
+{
+	auto& u = *m_upload;
+	auto budget = upload_budget;
+
+	m_staging.bind();
+	m_texture.bind_to(0);
+
+	while (u.level != m_levels)
+	{
+		auto size = level_size(m_size, u.level);
+		auto row_bytes = size.x * 4;
+
+		// Always make progress, even if a single row is over the budget
+		auto rows = std::min<size_t>(size.y - u.row, std::max<size_t>(budget / row_bytes, 1));
+		if (rows * row_bytes > m_staging.capacity() - m_staging.used())
+			break;
+
+		auto& data = u.levels[u.level];
+		auto begin = data.begin() + u.row * row_bytes;
+		auto first = m_staging.write(begin, begin + rows * row_bytes);
+
+		// With a pixel unpack buffer bound, the data pointer is an offset into it
+		auto* offset = reinterpret_cast<const void*>(m_staging.region_offset() + first);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, u.level, 0, u.row, u.slot, size.x, rows, 1, GL_RGBA, GL_UNSIGNED_BYTE, offset);
+
+		u.row += rows;
+		if (u.row == size.y)
+		{
+			u.row = 0;
+			u.level += 1;
+		}
+
+		if (rows * row_bytes >= budget)
+			break;
+
+		budget -= rows * row_bytes;
+	}
+
+	// Later texture uploads elsewhere must read from client memory again
+	hs::context::identifier<GL_BUFFER>::get_default(GL_PIXEL_UNPACK_BUFFER).bind();
+
+	if (u.level == m_levels)
+	{
+		m_slots[u.slot] = u.page;
+		m_upload.reset();
+	}
+}
@@ -6,6 +6,8 @@
 #include <iostream>
 #include <vector>
 
+#include <trace.hpp>
+
 //##############################################################################
 // Channel
 //##############################################################################
@@ -76,6 +78,8 @@ const std::string score::channel::get_preset_name() const {
 size_t score::channel::read(void* buf, size_t count) {
 	if (*m_score_playing == false) return 0;
 
+	TRACE_SCOPE("score::channel::read");
+
 	std::vector<channel_sample> d(count);
 
 	auto* lmf = m_current;
@@ -131,7 +135,7 @@ bool score::channel::end_of_stream() const {
 // Score
 //##############################################################################
 score::score(const std::string& midi_path, const std::string& soundfont_path, size_t frequency)
-: m_playing{false} {
+: m_playing{false}, m_played{0.0}, m_length{0.0} {
 	tsf* sf = tsf_load_filename(soundfont_path.c_str());
 	if (!sf)
 		throw std::runtime_error("Could not load SoundFont file: " + soundfont_path);
@@ -147,6 +151,7 @@ score::score(const std::string& midi_path, const std::string& soundfont_path, si
 		else
 			m_channels.at(chi)->push_event(mf);
 
+		m_length = mf->time;
 		mf = mf->next;
 	}
 
@@ -193,21 +198,37 @@ bool score::is_playing() const {
 	return m_playing;
 }
 
+double score::position() const {
+	if (!m_playing)
+		return m_played;
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - m_started;
+	return m_played + elapsed.count();
+}
+
 void score::play() {
+	if (!m_playing)
+		m_started = std::chrono::steady_clock::now();
+
 	m_playing = true;
 }
 
 void score::pause() {
+	m_played = position();
 	m_playing = false;
 }
 
 void score::stop() {
 	m_playing = false;
+	m_played = 0.0;
 
 	for (auto c : m_channels)
 		c.second->reset();
 }
 
 void score::toggle() {
-	m_playing = !m_playing;
+	if (m_playing)
+		pause();
+	else
+		play();
 }
\ No newline at end of file
@@ -0,0 +1,265 @@
+#include <simplify.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <utility>
+
+namespace
+{
+	// The squared distance to a set of planes, as a symmetric 4x4 matrix
+	struct quadric
+	{
+	public:
+		// The plane through a triangle, weighted by its area
+		static quadric from_triangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+		{
+			auto n = glm::cross(b - a, c - a);
+			auto area = glm::length(n);
+
+			quadric q{};
+			if (area <= 0.f)
+				return q;
+
+			n = n / area;
+			double p[4] = {n.x, n.y, n.z, -glm::dot(n, a)};
+
+			auto k = 0;
+			for (auto i = 0; i != 4; ++i)
+				for (auto j = i; j != 4; ++j)
+					q.m[k++] = p[i] * p[j] * area;
+
+			return q;
+		}
+
+	public:
+		quadric& operator +=(const quadric& other)
+		{
+			for (auto i = 0; i != 10; ++i)
+				m[i] += other.m[i];
+
+			return *this;
+		}
+
+		double error(const glm::vec3& v) const
+		{
+			double x = v.x, y = v.y, z = v.z;
+			return m[0]*x*x + 2*m[1]*x*y + 2*m[2]*x*z + 2*m[3]*x
+			     + m[4]*y*y + 2*m[5]*y*z + 2*m[6]*y
+			     + m[7]*z*z + 2*m[8]*z
+			     + m[9];
+		}
+
+	public:
+		// Upper triangle, row major
+		double m[10];
+	};
+
+	struct collapse
+	{
+	public:
+		double cost;
+		GLuint from;
+		GLuint to;
+	};
+
+	glm::vec3 triangle_normal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	{
+		return glm::cross(b - a, c - a);
+	}
+}
+
+std::vector<GLuint> simplify(const std::vector<glm::vec3>& positions, const std::vector<GLuint>& indices, size_t target_count)
+{
+	// Vertices sharing a position (eg, split by normals) collapse together
+	// Each is represented by the first vertex found at that position
+	/* Positions are compared on a grid a millionth of the mesh's size, so seams
+	* that are only nearly coincident still weld; two points either side of a
+	* grid line can still stay apart, which only leaves that seam locked
+	*/
+	std::vector<GLuint> weld(positions.size());
+	if (!positions.empty())
+	{
+		auto lo = positions.front(), hi = positions.front();
+		for (auto& p : positions)
+		{
+			lo = glm::min(lo, p);
+			hi = glm::max(hi, p);
+		}
+
+		auto cell = std::max(glm::length(hi - lo) * 1e-6f, std::numeric_limits<float>::min());
+
+		std::map<std::array<std::int64_t, 3>, GLuint> first;
+		for (auto i = 0u; i != positions.size(); ++i)
+		{
+			auto q = glm::round(positions[i] / cell);
+			std::array<std::int64_t, 3> key = {std::int64_t(q.x), std::int64_t(q.y), std::int64_t(q.z)};
+
+			weld[i] = first.emplace(key, i).first->second;
+		}
+	}
+
+	// Collapses work on welded vertices, but untouched corners keep their own vertex
+	std::vector<GLuint> result;
+	std::vector<GLuint> corners = indices;
+
+	result.reserve(indices.size());
+	for (auto i : indices)
+		result.push_back(weld[i]);
+
+	std::vector<quadric> quadrics(positions.size(), quadric{});
+	for (auto i = 0u; i + 2 < result.size(); i += 3)
+	{
+		auto q = quadric::from_triangle(positions[result[i]], positions[result[i + 1]], positions[result[i + 2]]);
+		for (auto k = 0; k != 3; ++k)
+			quadrics[result[i + k]] += q;
+	}
+
+	// An edge used by a single triangle is on a border
+	std::vector<char> locked(positions.size(), 0);
+	{
+		std::map<std::pair<GLuint, GLuint>, int> edges;
+		for (auto i = 0u; i + 2 < result.size(); i += 3)
+		{
+			for (auto k = 0; k != 3; ++k)
+			{
+				auto a = result[i + k], b = result[i + (k + 1) % 3];
+				edges[std::minmax(a, b)] += 1;
+			}
+		}
+
+		for (auto& e : edges)
+			if (e.second == 1)
+				locked[e.first.first] = locked[e.first.second] = 1;
+	}
+
+	std::vector<GLuint> remap(positions.size());
+	for (auto i = 0u; i != remap.size(); ++i)
+		remap[i] = i;
+
+	// Collapse the cheapest independent edges in passes until the target is met
+	while (result.size() > target_count)
+	{
+		std::vector<std::vector<size_t>> adjacent(positions.size());
+		std::vector<collapse> candidates;
+
+		for (auto i = 0u; i + 2 < result.size(); i += 3)
+		{
+			for (auto k = 0; k != 3; ++k)
+			{
+				auto a = result[i + k], b = result[i + (k + 1) % 3];
+				adjacent[a].push_back(i);
+
+				quadric q = quadrics[a];
+				q += quadrics[b];
+
+				if (!locked[a])
+					candidates.push_back({q.error(positions[b]), a, b});
+				if (!locked[b])
+					candidates.push_back({q.error(positions[a]), b, a});
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](const collapse& x, const collapse& y) {
+			return (x.cost < y.cost);
+		});
+
+		// Each collapse removes about two triangles
+		auto excess = (result.size() - target_count) / 3;
+		size_t removed = 0;
+
+		std::vector<char> touched(positions.size(), 0);
+		for (auto& c : candidates)
+		{
+			if (removed >= excess)
+				break;
+			if (touched[c.from] || touched[c.to])
+				continue;
+
+			// Moving a vertex must not turn any of its triangles over
+			bool flips = false;
+			for (auto t : adjacent[c.from])
+			{
+				std::array<GLuint, 3> tri = {result[t], result[t + 1], result[t + 2]};
+				if (std::find(tri.begin(), tri.end(), c.to) != tri.end())
+					continue;
+
+				auto before = triangle_normal(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+				std::replace(tri.begin(), tri.end(), c.from, c.to);
+				auto after = triangle_normal(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+
+				if (glm::dot(before, after) <= 0.f)
+				{
+					flips = true;
+					break;
+				}
+			}
+
+			if (flips)
+				continue;
+
+			remap[c.from] = c.to;
+			quadrics[c.to] += quadrics[c.from];
+
+			// The flip test above assumed the whole one-ring stays where it is
+			touched[c.from] = touched[c.to] = 1;
+			for (auto t : adjacent[c.from])
+				for (auto k = 0; k != 3; ++k)
+					touched[result[t + k]] = 1;
+
+			removed += 2;
+		}
+
+		if (!removed)
+			break;
+
+		// A corner that moves takes the attributes (eg, normal) of the corner it moved
+		// onto in a collapsed triangle, which is on the same side of any seam
+		const auto none = std::numeric_limits<GLuint>::max();
+		std::vector<GLuint> carried(positions.size(), none);
+
+		for (auto i = 0u; i + 2 < result.size(); i += 3)
+		{
+			for (auto k = 0; k != 3; ++k)
+			{
+				auto to = remap[result[i + k]];
+				if (to == result[i + k])
+					continue;
+
+				for (auto j = 0; j != 3; ++j)
+					if (result[i + j] == to)
+						carried[corners[i + k]] = corners[i + j];
+			}
+		}
+
+		// Apply this pass, dropping the triangles that became degenerate
+		std::vector<GLuint> next, next_corners;
+		next.reserve(result.size());
+		next_corners.reserve(result.size());
+
+		for (auto i = 0u; i + 2 < result.size(); i += 3)
+		{
+			GLuint a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+
+			next.insert(next.end(), {a, b, c});
+			for (auto k = 0; k != 3; ++k)
+			{
+				auto to = next[next.size() - 3 + k];
+				if (to == result[i + k])
+					next_corners.push_back(corners[i + k]);
+				else
+					next_corners.push_back((carried[corners[i + k]] != none) ? carried[corners[i + k]] : to);
+			}
+		}
+
+		result = std::move(next);
+		corners = std::move(next_corners);
+	}
+
+	return corners;
+}
@@ -0,0 +1,250 @@
+#include <simulated_hmd.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
+{
+	const char* device_names[] = {"head", "left", "right"};
+
+	// Poses of each device every 1/16s, looping after eight seconds
+	std::array<std::vector<simulated_hmd::keyframe>, 3> default_script()
+	{
+		std::array<std::vector<simulated_hmd::keyframe>, 3> tracks;
+
+		constexpr double duration = 8.0;
+		constexpr double step = 1.0 / 16.0;
+		constexpr double pi = 3.14159265358979323846;
+
+		for (auto i = 0; i * step <= duration; ++i)
+		{
+			auto t = i * step;
+
+			// Look slowly to either side, so culling and LOD selection see the view change
+			auto yaw = static_cast<float>(glm::radians(30.0) * std::sin(2.0 * pi * t / duration));
+			tracks[0].push_back({t, {0.f, 1.7f, 0.f}, glm::angleAxis(yaw, glm::vec3(0.f, 1.f, 0.f)), 0});
+
+			tracks[1].push_back({t, {-0.25f, 1.1f, -0.3f}, glm::quat(1.f, 0.f, 0.f, 0.f), 0});
+
+			// One beat down and up every half second
+			auto height = static_cast<float>(1.35 + 0.12 * std::cos(2.0 * pi * 2.0 * t));
+			auto pitch = glm::angleAxis(glm::radians(-20.f), glm::vec3(1.f, 0.f, 0.f));
+			std::uint32_t buttons = (t == 1.0) ? xr_trigger : 0;
+
+			tracks[2].push_back({t, {0.2f, height, -0.35f}, pitch, buttons});
+		}
+
+		return tracks;
+	}
+}
+
+simulated_hmd::simulated_hmd(const settings& s)
+	: m_settings{s}, m_tracks(default_script()), m_duration{0.0}, m_frames{0}, m_missed{0},
+	  m_started{false}, m_total_time{0.0}, m_max_time{0.0}
+{
+	for (auto& track : m_tracks)
+		m_duration = std::max(m_duration, track.back().time);
+}
+
+simulated_hmd::simulated_hmd(const settings& s, std::istream& script)
+	: m_settings{s}, m_duration{0.0}, m_frames{0}, m_missed{0},
+	  m_started{false}, m_total_time{0.0}, m_max_time{0.0}
+{
+	std::string line;
+	for (size_t number = 1; std::getline(script, line); ++number)
+	{
+		// Scripts written on Windows keep their carriage returns
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream fields(line);
+
+		keyframe k;
+		std::string device;
+		fields >> k.time >> device
+		       >> k.position.x >> k.position.y >> k.position.z
+		       >> k.orientation.w >> k.orientation.x >> k.orientation.y >> k.orientation.z
+		       >> k.buttons;
+
+		// A bad line is skipped, so the rest of the script still plays
+		if (!fields)
+		{
+			std::clog << "simulated_hmd: skipping malformed keyframe on line " << number << std::endl;
+			continue;
+		}
+
+		auto name = std::find(std::begin(device_names), std::end(device_names), device);
+		if (name == std::end(device_names))
+		{
+			std::clog << "simulated_hmd: skipping unknown device \"" << device << "\" on line " << number << std::endl;
+			continue;
+		}
+
+		m_tracks[name - std::begin(device_names)].push_back(k);
+		m_duration = std::max(m_duration, k.time);
+	}
+
+	for (auto& track : m_tracks)
+	{
+		std::stable_sort(track.begin(), track.end(), [](const keyframe& a, const keyframe& b) {
+			return (a.time < b.time);
+		});
+	}
+}
+
+void simulated_hmd::wait_frame()
+{
+	auto now = clock::now();
+
+	if (m_settings.refresh_rate > 0.f)
+	{
+		auto step = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(period()));
+		if (!m_started)
+			m_next_refresh = now;
+
+		// A frame submitted late starts on the first refresh after now
+		if (m_next_refresh < now)
+			m_next_refresh += step * ((now - m_next_refresh) / step + 1);
+
+		std::this_thread::sleep_until(m_next_refresh);
+
+		m_frame_start = m_next_refresh;
+		m_deadline = m_frame_start + step;
+	}
+	else
+	{
+		m_frame_start = now;
+	}
+
+	m_started = true;
+	sample(m_frames * period());
+}
+
+void simulated_hmd::submit(GLuint)
+{
+	if (m_settings.wait_for_gpu)
+		glFinish();
+
+	auto now = clock::now();
+
+	std::chrono::duration<double, std::milli> taken = now - m_frame_start;
+	m_total_time += taken.count();
+	m_max_time = std::max(m_max_time, taken.count());
+
+	if (m_settings.refresh_rate > 0.f)
+	{
+		// The last frame is shown again for every refresh passed
+		if (now > m_deadline)
+		{
+			auto step = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(period()));
+			m_missed += static_cast<size_t>((now - m_deadline) / step) + 1;
+		}
+
+		m_next_refresh = m_deadline;
+	}
+
+	m_frames += 1;
+}
+
+glm::mat4 simulated_hmd::projection(xr_eye, float near_plane, float far_plane) const
+{
+	auto aspect = static_cast<float>(m_settings.render_size.x) / m_settings.render_size.y;
+	return glm::perspective(m_settings.vertical_fov, aspect, near_plane, far_plane);
+}
+
+glm::mat4 simulated_hmd::eye_to_head(xr_eye e) const
+{
+	auto offset = (e == xr_eye::left) ? -0.5f : 0.5f;
+	return glm::translate(glm::mat4(1.f), glm::vec3(offset * m_settings.ipd, 0.f, 0.f));
+}
+
+void simulated_hmd::report(std::ostream& out) const
+{
+	if (!m_frames)
+		return;
+
+	out << "Simulated HMD: " << m_frames << " frames, " << m_missed << " missed refreshes";
+	if (m_settings.refresh_rate > 0.f)
+		out << " at " << m_settings.refresh_rate << "Hz";
+	out << std::endl;
+
+	out << "Frame time: " << m_total_time / m_frames << "ms average, " << m_max_time << "ms worst" << std::endl;
+}
+
+void simulated_hmd::record(std::ostream& out, double time, const xr_runtime& runtime)
+{
+	const xr_device* devices[] = {&runtime.head(), &runtime.hand(xr_hand::left), &runtime.hand(xr_hand::right)};
+
+	for (auto i = 0u; i != 3; ++i)
+	{
+		auto& d = *devices[i];
+		if (!d.valid)
+			continue;
+
+		auto p = glm::vec3(d.pose[3]);
+		auto q = glm::quat_cast(glm::mat3(d.pose));
+
+		out << time << ' ' << device_names[i] << ' '
+		    << p.x << ' ' << p.y << ' ' << p.z << ' '
+		    << q.w << ' ' << q.x << ' ' << q.y << ' ' << q.z << ' '
+		    << d.buttons << '\n';
+	}
+}
+
+double simulated_hmd::period() const
+{
+	// Unpaced runs still step poses as if at 90Hz
+	auto rate = (m_settings.refresh_rate > 0.f) ? m_settings.refresh_rate : 90.f;
+	return 1.0 / rate;
+}
+
+void simulated_hmd::sample(double time)
+{
+	if (m_duration > 0.0)
+		time = std::fmod(time, m_duration);
+
+	for (auto i = 0u; i != m_tracks.size(); ++i)
+	{
+		auto& track = m_tracks[i];
+		auto& d = m_devices[i];
+
+		d.valid = !track.empty();
+		if (!d.valid)
+			continue;
+
+		auto next = std::upper_bound(track.begin(), track.end(), time, [](double t, const keyframe& k) {
+			return (t < k.time);
+		});
+
+		keyframe k;
+		if (next == track.begin())
+		{
+			k = track.front();
+		}
+		else if (next == track.end())
+		{
+			k = track.back();
+		}
+		else
+		{
+			auto& a = *(next - 1);
+			auto& b = *next;
+
+			auto f = static_cast<float>((time - a.time) / (b.time - a.time));
+			k = {time, glm::mix(a.position, b.position, f), glm::slerp(a.orientation, b.orientation, f), a.buttons};
+		}
+
+		d.pose = glm::translate(glm::mat4(1.f), k.position) * glm::mat4_cast(k.orientation);
+		d.buttons = k.buttons;
+	}
+}
@@ -0,0 +1,139 @@
+#include <trace.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	struct event
+	{
+	public:
+		const char* name;
+		std::int64_t begin;
+		std::int64_t duration;
+	};
+
+	// Written by a single thread; read by write_json
+	struct thread_buffer
+	{
+	public:
+		size_t id;
+		std::atomic<const char*> name{nullptr};
+
+		std::vector<event> events = std::vector<event>(trace::capacity);
+		// Events ever written; the latest are at (count - 1) % capacity and before
+		std::atomic<size_t> count{0};
+	};
+
+	// Buffers outlive their threads, so the events of finished threads are kept
+	std::mutex g_mutex;
+	std::vector<std::unique_ptr<thread_buffer>> g_buffers;
+
+	thread_local thread_buffer* g_buffer = nullptr;
+
+	thread_buffer& local_buffer()
+	{
+		if (!g_buffer)
+		{
+			std::lock_guard<std::mutex> lock(g_mutex);
+
+			g_buffers.push_back(std::make_unique<thread_buffer>());
+			g_buffers.back()->id = g_buffers.size();
+			g_buffer = g_buffers.back().get();
+		}
+
+		return *g_buffer;
+	}
+
+	// Names are written by the program, but may still need escaping
+	void write_string(std::ostream& out, const char* s)
+	{
+		out << '"';
+		for (; *s; ++s)
+		{
+			if (*s == '"' || *s == '\\')
+				out << '\\';
+			out << *s;
+		}
+		out << '"';
+	}
+}
+
+std::atomic<bool> trace::g_enabled{false};
+
+trace::scope::scope(const char* name)
+: m_name{nullptr}, m_begin{0}
+{
+	if (!enabled())
+		return;
+
+	m_name = name;
+	m_begin = now();
+}
+
+trace::scope::~scope()
+{
+	// Scopes that began while disabled are never recorded
+	if (!m_name)
+		return;
+
+	auto& b = local_buffer();
+	auto index = b.count.load(std::memory_order_relaxed);
+
+	b.events[index % capacity] = {m_name, m_begin, now() - m_begin};
+	b.count.store(index + 1, std::memory_order_release);
+}
+
+void trace::name_thread(const char* name)
+{
+	local_buffer().name.store(name, std::memory_order_relaxed);
+}
+
+void trace::write_json(std::ostream& out)
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+
+	out << "{\"traceEvents\":[";
+
+	bool first = true;
+	auto separate = [&first, &out]() {
+		if (!first)
+			out << ",\n";
+		first = false;
+	};
+
+	for (auto& b : g_buffers)
+	{
+		if (auto* name = b->name.load(std::memory_order_relaxed))
+		{
+			separate();
+			out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << b->id << ",\"args\":{\"name\":";
+			write_string(out, name);
+			out << "}}";
+		}
+
+		auto count = b->count.load(std::memory_order_acquire);
+		auto kept = std::min(count, capacity);
+
+		for (auto i = count - kept; i != count; ++i)
+		{
+			auto& e = b->events[i % capacity];
+
+			separate();
+			out << "{\"ph\":\"X\",\"name\":";
+			write_string(out, e.name);
+			out << ",\"pid\":1,\"tid\":" << b->id << ",\"ts\":" << e.begin << ",\"dur\":" << e.duration << "}";
+		}
+	}
+
+	out << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+}
+
+std::int64_t trace::now()
+{
+	static const auto epoch = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+}